@@ -2,12 +2,105 @@
 #include "global.h"
 
 #include "gc.h"
+#include "cons.h"
+#include "stack.h"
 #include "closure.h"
+#include "lexical.h"
+
+/* makes the stack that a call to cls runs in */
+static ref_t _call_stack(closure_t *cls, int *local)
+{
+	/* a body that can't capture its frame gets a stack that the collector doesn't need to know about */
+	*local = lexical_body_is_leaf(cls->body);
+	if (*local)
+		return make_local_stack(cls->env, cls->frame_size);
+	else
+		return make_stack_sized(cls->env, cls->frame_size);
+}
+
+static void _release_call_stack(ref_t *param_frame, int local)
+{
+	if (local)
+		release_local_stack(param_frame);
+	else
+		release_ref(param_frame);
+}
+
+/* makes the stack for a call to callee, a closure or function, with args bound the way
+   its type binds them */
+static ref_t _bind_call(ref_t callee, ref_t args, ref_t calling_context, int *local)
+{
+	closure_t *cls = (closure_t*)callee.data.object;
+	ref_t param_frame, it, name;
+
+	param_frame = _call_stack(cls, local);
+
+	if (callee.type == function_type)
+	{
+		/* each argument is evaluated straight into its parameter's slot */
+		map_let_eval(param_frame, cls->param_list, args, calling_context);
+		return param_frame;
+	}
+
+	/* the same as (apply callee (list args calling_context)), without making the list */
+	it = cls->param_list;
+	if (it.type == cons_type)
+	{
+		name = ((cons_t*)it.data.object)->car;
+		stack_let(param_frame, name, args);
+		it = ((cons_t*)it.data.object)->cdr;
+	}
+	if (it.type == cons_type)
+	{
+		name = ((cons_t*)it.data.object)->car;
+		stack_let(param_frame, name, calling_context);
+		it = ((cons_t*)it.data.object)->cdr;
+	}
+	for (; it.type == cons_type; it = ((cons_t*)it.data.object)->cdr)
+		stack_let(param_frame, ((cons_t*)it.data.object)->car, nil());
+
+	return param_frame;
+}
+
+/* evaluates callee's body in param_frame, and then releases param_frame.  when the body
+   ends with a call to a function or closure, that call's stack takes the place of
+   param_frame, and its body is evaluated by the same loop, so that calls in tail
+   position don't use up the C stack */
+static ref_t _call_body(ref_t callee, ref_t param_frame, int local)
+{
+	ref_t result, next, args, next_frame;
+	int next_local;
+
+	callee = clone_ref(callee);
+
+	for (;;)
+	{
+		result = lexical_eval_tail(((closure_t*)callee.data.object)->body, param_frame, &next, &args);
+		if (next.type == NIL)
+			break;
+
+		trace(TRACE_FULL, "tail calling %r with args %r", next, args);
+		next_frame = _bind_call(next, args, param_frame, &next_local);
+
+		_release_call_stack(&param_frame, local);
+		release_ref(&callee);
+
+		callee = next;
+		param_frame = next_frame;
+		local = next_local;
+	}
+
+	_release_call_stack(&param_frame, local);
+	release_ref(&callee);
+
+	return result;
+}
 
 ref_t apply(ref_t func, ref_t args)
 {
 	closure_t *cls;
-	ref_t result, param_frame;
+	ref_t param_frame;
+	int local;
 
 	if (func.type != closure_type &&
 		func.type != function_type &&
@@ -18,17 +111,12 @@ ref_t apply(ref_t func, ref_t args)
 	}
 
 	cls = (closure_t*)func.data.object;
-
-	param_frame = make_stack(cls->env);
+	param_frame = _call_stack(cls, &local);
 
 	/* register params in the params_frame */
 	map_let(param_frame, cls->param_list, args);
 
-	result = eval(cls->code, param_frame);
-
-	release_ref(&param_frame);
-
-	return result;
+	return _call_body(func, param_frame, local);
 }
 
 static void _closure_print_contents(closure_t *cls, FILE *to)
@@ -49,6 +137,7 @@ static void closure_traits_gc_mark(ref_t instance)
 
 	ref_gc_mark(cls->param_list);
 	ref_gc_mark(cls->code);
+	ref_gc_mark(cls->body);
 	ref_gc_mark(cls->env);
 }
 
@@ -59,6 +148,7 @@ static void closure_traits_gc_release_refs(ref_t instance)
 
 	release_ref(&(cls->param_list));
 	release_ref(&(cls->code));
+	release_ref(&(cls->body));
 	release_ref(&(cls->env));
 }
 
@@ -84,12 +174,13 @@ static ref_t closure_traits_type_name(ref_t instance)
 
 static ref_t closure_traits_execute(ref_t instance, ref_t args, ref_t calling_context)
 {
-	ref_t result, cl_args;
+	ref_t param_frame;
+	int local;
+
 	trace(TRACE_FULL, "calling %r with args %r in env %r", instance, args, calling_context);
-	cl_args = list(args, calling_context);
-	result = apply(instance, cl_args);
-	release_ref(&cl_args);
-	return result;
+
+	param_frame = _bind_call(instance, args, calling_context, &local);
+	return _call_body(instance, param_frame, local);
 }
 
 static int closure_traits_eq(ref_t a, ref_t b)
@@ -113,6 +204,7 @@ static const type_traits_t closure_traits =
 	closure_traits_type_name,
 	closure_traits_eq,
 	closure_traits_eql,
+	0, /* no hash; hash_eql puts all closures together */
 	gc_traits_addref,
 	gc_traits_release,
 	closure_traits_gc_mark,
@@ -125,12 +217,13 @@ const type_traits_t *closure_type = &closure_traits;
 
 static ref_t function_traits_execute(ref_t instance, ref_t args, ref_t calling_context)
 {
-	ref_t result, fn_args;
-	fn_args = map_eval(args, calling_context);
-	trace(TRACE_FULL, "calling %r with args %r", instance, fn_args);
-	result = apply(instance, fn_args);
-	release_ref(&fn_args);
-	return result;
+	ref_t param_frame;
+	int local;
+
+	trace(TRACE_FULL, "calling %r with args %r", instance, args);
+
+	param_frame = _bind_call(instance, args, calling_context, &local);
+	return _call_body(instance, param_frame, local);
 }
 
 static void function_traits_print(ref_t instance, FILE *to)
@@ -153,6 +246,7 @@ static const type_traits_t function_traits =
 	function_traits_type_name,
 	closure_traits_eq,
 	closure_traits_eql,
+	0, /* no hash; hash_eql puts all functions together */
 	gc_traits_addref,
 	gc_traits_release,
 	closure_traits_gc_mark,
@@ -193,6 +287,7 @@ static const type_traits_t macro_traits =
 	macro_traits_type_name,
 	closure_traits_eq,
 	closure_traits_eql,
+	0, /* no hash; hash_eql puts all macros together */
 	gc_traits_addref,
 	gc_traits_release,
 	closure_traits_gc_mark,
@@ -201,7 +296,7 @@ static const type_traits_t macro_traits =
 };
 const type_traits_t *macro_type = &macro_traits;
 
-ref_t _make_closure(ref_t plist, ref_t code, ref_t env, const type_traits_t *vt)
+ref_t make_resolved_closure(ref_t plist, ref_t code, ref_t body, ref_t env, const type_traits_t *vt)
 {
 	ref_t ref;
 	closure_t *cls;
@@ -223,13 +318,26 @@ ref_t _make_closure(ref_t plist, ref_t code, ref_t env, const type_traits_t *vt)
 
 	cls->param_list = clone_ref(plist);
 	cls->code = clone_ref(code);
+	cls->body = clone_ref(body);
 	cls->env = clone_ref(env);
+	cls->frame_size = lexical_frame_size(plist);
 
 	ref.type = vt;
 	ref.data.object = &cls->gc;
 	return ref;
 }
 
+ref_t _make_closure(ref_t plist, ref_t code, ref_t env, const type_traits_t *vt)
+{
+	ref_t body, ref;
+
+	body = lexical_resolve(plist, code, env);
+	ref = make_resolved_closure(plist, code, body, env, vt);
+	release_ref(&body);
+
+	return ref;
+}
+
 ref_t make_closure(ref_t plist, ref_t code, ref_t env)
 {
 	return _make_closure(plist, code, env, closure_type);
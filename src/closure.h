@@ -14,7 +14,9 @@ typedef struct closure_ts
 	gc_object_t gc;
 	ref_t param_list;
 	ref_t code;
+	ref_t body; /* code after lexical_resolve; this is what actually gets evaluated */
 	ref_t env;
+	size_t frame_size; /* number of slots the parameters take up */
 } closure_t;
 
 #ifdef __cplusplus
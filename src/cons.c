@@ -74,6 +74,24 @@ static int cons_traits_eql(ref_t a, ref_t b)
 	return eql(ac->car, bc->car) && eql(ac->cdr, bc->cdr);
 }
 
+static size_t cons_traits_hash(ref_t instance)
+{
+	size_t h = 0, n;
+	ref_t it = instance;
+
+	for (n = 0; n != HASH_MAX_ITEMS && it.type == cons_type; ++n)
+	{
+		h = hash_combine(h, hash_eql(((cons_t*)it.data.object)->car));
+		it = ((cons_t*)it.data.object)->cdr;
+	}
+
+	/* a dotted tail only counts if the whole list was hashed */
+	if (it.type != cons_type)
+		h = hash_combine(h, hash_eql(it));
+
+	return h;
+}
+
 static ref_t cons_traits_eval(ref_t instance, ref_t context)
 {
 	ref_t result;
@@ -101,19 +119,24 @@ static ref_t cons_traits_eval(ref_t instance, ref_t context)
 	}
 	else if (lar.type->eval)
 	{
-		/* evaluate the car in case it can be turned into a callable,
-		   and then try to re-evaluate the cons */
+		/* evaluate the car in case it can be turned into a callable */
 		ref_t new_lar, ldr, new_cons;
 
 		new_lar = eval(lar, context);
 		ldr = cdr(instance);
 
-		new_cons = make_cons(new_lar, ldr);
+		if (new_lar.type && new_lar.type->execute)
+			result = new_lar.type->execute(new_lar, ldr, context);
+		else
+		{
+			/* try to re-evaluate the cons with it */
+			new_cons = make_cons(new_lar, ldr);
+			result = eval(new_cons, context);
+			release_ref(&new_cons);
+		}
+
 		release_ref(&new_lar);
 		release_ref(&ldr);
-
-		result = eval(new_cons, context);
-		release_ref(&new_cons);
 	}
 
 	release_ref(&lar);
@@ -129,6 +152,7 @@ static const type_traits_t cons_traits =
 	cons_traits_type_name,
 	cons_traits_eq,
 	cons_traits_eql,
+	cons_traits_hash,
 	gc_traits_addref,
 	gc_traits_release,
 	cons_traits_gc_mark,
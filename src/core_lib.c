@@ -2,8 +2,19 @@
 #include "global.h"
 
 #include "smalisp.h"
+#include "cons.h"
+#include "symbol.h"
+#include "sl_string.h"
 #include "stack_frame.h"
 #include "closure.h"
+#include "sl_vector.h"
+#include "sl_numvec.h"
+#include "sl_hash_table.h"
+#include "sl_sorted_map.h"
+#include "sl_pvec.h"
+#include "sl_pmap.h"
+#include "sl_struct.h"
+#include "lexical.h"
 
 #include "core_lib.h"
 
@@ -11,6 +22,9 @@
 #pragma warning(disable: 4996) /* 'foo' was declared deprecated [yeah, right, by whom, exactly?] */
 #endif
 
+/* the nth argument of a foreign vexec, or nil if there weren't that many */
+#define VARG(n) ((n) < argc ? argv[(n)] : nil())
+
 static FILE *_sl_print_fl = 0;
 static FILE *_sl_read_fl = 0;
 
@@ -29,110 +43,342 @@ ref_t slfe_quote(ref_t args, ref_t assoc)
 	return car(args);
 }
 
-ref_t slfe_eq(ref_t args, ref_t assoc)
+ref_t slfe_eq(const ref_t *argv, size_t argc, ref_t env)
 {
-	ref_t result;
-	ref_t processed_args = map_eval(args, assoc);
-	ref_t a = car(processed_args);
-	ref_t b = cadr(processed_args);
-	release_ref(&processed_args);
+	if (eq(VARG(0), VARG(1)))
+		return make_symbol("t", 0);
+	else
+		return nil();
+}
 
-	if (eq(a, b))
-		result = make_symbol("t", 0);
+ref_t slfe_eql(const ref_t *argv, size_t argc, ref_t env)
+{
+	if (eql(VARG(0), VARG(1)))
+		return make_symbol("t", 0);
 	else
-		result = nil();
+		return nil();
+}
 
-	release_ref(&a);
-	release_ref(&b);
+/* evaluates a tail_form_t form all the way through */
+static ref_t _eval_tail_form(tail_form_t form, ref_t args, ref_t assoc)
+{
+	ref_t tail, result;
 
+	if (form(args, assoc, &tail, &result))
+		return eval(tail, assoc);
 	return result;
 }
 
-ref_t slfe_eql(ref_t args, ref_t assoc)
+/* (cond (test expr) ...) */
+int slfe_cond_tail(ref_t args, ref_t assoc, ref_t *tail, ref_t *result)
 {
-	ref_t result;
-	ref_t processed_args = map_eval(args, assoc);
-	ref_t a = car(processed_args);
-	ref_t b = cadr(processed_args);
-	release_ref(&processed_args);
+	ref_t clause, test;
+	int passed;
 
-	if (eql(a, b))
-		result = make_symbol("t", 0);
-	else
-		result = nil();
+	for (; args.type == cons_type; args = ((cons_t*)args.data.object)->cdr)
+	{
+		clause = ((cons_t*)args.data.object)->car;
+		if (clause.type != cons_type)
+			continue;
 
-	release_ref(&a);
-	release_ref(&b);
+		test = eval(((cons_t*)clause.data.object)->car, assoc);
+		passed = test.type != NIL;
+		release_ref(&test);
 
-	return result;
+		if (passed)
+		{
+			clause = ((cons_t*)clause.data.object)->cdr;
+			*tail = clause.type == cons_type ? ((cons_t*)clause.data.object)->car : nil();
+			return 1;
+		}
+	}
+
+	*result = nil();
+	return 0;
 }
 
 ref_t slfe_cond(ref_t args, ref_t assoc)
 {
-	ref_t result;
-	ref_t test, test_result, body, rest;
+	return _eval_tail_form(slfe_cond_tail, args, assoc);
+}
 
-	if (args.type == NIL)
-		return nil();
+/* evaluates the first form in args, and returns 1 if it was non-nil; *rest is set to the forms after it */
+static int _eval_test(ref_t args, ref_t env, ref_t *rest)
+{
+	ref_t test;
+	int passed;
+
+	if (args.type != cons_type)
+	{
+		*rest = nil();
+		return 0;
+	}
 
-	test = caar(args);
-	test_result = eval(test, assoc);
+	test = eval(((cons_t*)args.data.object)->car, env);
+	passed = test.type != NIL;
 	release_ref(&test);
 
-	if (test_result.type != NIL)
+	*rest = ((cons_t*)args.data.object)->cdr;
+	return passed;
+}
+
+/* (if test then [else]) */
+int slfe_if_tail(ref_t args, ref_t assoc, ref_t *tail, ref_t *result)
+{
+	ref_t rest;
+
+	if (!_eval_test(args, assoc, &rest))
 	{
-		body = cadar(args);
-		result = eval(body, assoc);
-		release_ref(&body);
+		if (rest.type == cons_type)
+			rest = ((cons_t*)rest.data.object)->cdr;
 	}
-	else
+
+	if (rest.type != cons_type)
 	{
-		rest = cdr(args);
-		result = slfe_cond(rest, assoc);
-		release_ref(&rest);
+		*result = nil();
+		return 0;
 	}
-	release_ref(&test_result);
-	return result;
+
+	*tail = ((cons_t*)rest.data.object)->car;
+	return 1;
 }
 
-ref_t slfe_car(ref_t args, ref_t assoc)
+ref_t slfe_if(ref_t args, ref_t assoc)
 {
-	ref_t result, arg, arge;
-	arg = car(args);
-	arge = eval(arg, assoc);
-	release_ref(&arg);
-	result = car(arge);
-	release_ref(&arge);
-	return result;
+	return _eval_tail_form(slfe_if_tail, args, assoc);
 }
 
-ref_t slfe_cdr(ref_t args, ref_t assoc)
+/* (when test body...) */
+int slfe_when_tail(ref_t args, ref_t assoc, ref_t *tail, ref_t *result)
 {
-	ref_t result, arg, arge;
-	arg = car(args);
-	arge = eval(arg, assoc);
-	release_ref(&arg);
-	result = cdr(arge);
-	release_ref(&arge);
-	return result;
+	ref_t body;
+
+	if (_eval_test(args, assoc, &body))
+		return eval_body_tail(body, assoc, tail, result);
+
+	*result = nil();
+	return 0;
 }
 
-ref_t slfe_atom(ref_t args, ref_t assoc)
+ref_t slfe_when(ref_t args, ref_t assoc)
 {
-	ref_t result, arg, arge;
-	arg = car(args);
-	arge = eval(arg, assoc);
-	release_ref(&arg);
+	return _eval_tail_form(slfe_when_tail, args, assoc);
+}
 
-	if (arge.type == cons_type)
-		result = nil();
-	else
-		result = make_symbol("t", 0);
+/* (unless test body...) */
+int slfe_unless_tail(ref_t args, ref_t assoc, ref_t *tail, ref_t *result)
+{
+	ref_t body;
+
+	if (!_eval_test(args, assoc, &body))
+		return eval_body_tail(body, assoc, tail, result);
+
+	*result = nil();
+	return 0;
+}
+
+ref_t slfe_unless(ref_t args, ref_t assoc)
+{
+	return _eval_tail_form(slfe_unless_tail, args, assoc);
+}
+
+/* (and forms...); stops at the first form that gives nil.  returns the last value, or t if there were no forms */
+int slfe_and_tail(ref_t args, ref_t assoc, ref_t *tail, ref_t *result)
+{
+	ref_t val;
+	cons_t *cons;
+
+	if (args.type != cons_type)
+	{
+		*result = make_symbol("t", 0);
+		return 0;
+	}
+
+	for (cons = (cons_t*)args.data.object; cons->cdr.type == cons_type; cons = (cons_t*)cons->cdr.data.object)
+	{
+		val = eval(cons->car, assoc);
+		if (val.type == NIL)
+		{
+			*result = val;
+			return 0;
+		}
+		release_ref(&val);
+	}
+
+	*tail = cons->car;
+	return 1;
+}
+
+ref_t slfe_and(ref_t args, ref_t assoc)
+{
+	return _eval_tail_form(slfe_and_tail, args, assoc);
+}
+
+/* (or forms...); returns the first value that isn't nil, without evaluating the rest */
+int slfe_or_tail(ref_t args, ref_t assoc, ref_t *tail, ref_t *result)
+{
+	ref_t val;
+	cons_t *cons;
+
+	if (args.type != cons_type)
+	{
+		*result = nil();
+		return 0;
+	}
+
+	for (cons = (cons_t*)args.data.object; cons->cdr.type == cons_type; cons = (cons_t*)cons->cdr.data.object)
+	{
+		val = eval(cons->car, assoc);
+		if (val.type != NIL)
+		{
+			*result = val;
+			return 0;
+		}
+	}
+
+	*tail = cons->car;
+	return 1;
+}
+
+ref_t slfe_or(ref_t args, ref_t assoc)
+{
+	return _eval_tail_form(slfe_or_tail, args, assoc);
+}
+
+/* (while test body...); always returns nil */
+ref_t slfe_while(ref_t args, ref_t assoc)
+{
+	ref_t body, result;
+
+	while (_eval_test(args, assoc, &body))
+	{
+		result = eval_body(body, assoc);
+		release_ref(&result);
+	}
+
+	return nil();
+}
+
+int case_is_default(ref_t keys)
+{
+	const char *name;
+
+	if (keys.type != symbol_type)
+		return 0;
+
+	name = symbol_c_str(keys);
+	return strcmp(name, "t") == 0 || strcmp(name, "otherwise") == 0;
+}
+
+/* (case key clause...), where each clause is (keys body...), and keys is either a
+   single key or a list of them.  the first clause with a key eql to the value of key,
+   or whose keys are t or otherwise, has its body evaluated.  (closure bodies get a
+   hashed version of this; see case_site_t) */
+int slfe_case_tail(ref_t args, ref_t assoc, ref_t *tail, ref_t *result)
+{
+	ref_t key, it, keys, kt;
+	cons_t *clause;
+
+	if (args.type != cons_type)
+	{
+		*result = nil();
+		return 0;
+	}
+
+	key = eval(((cons_t*)args.data.object)->car, assoc);
+
+	for (it = ((cons_t*)args.data.object)->cdr; it.type == cons_type; it = ((cons_t*)it.data.object)->cdr)
+	{
+		if (((cons_t*)it.data.object)->car.type != cons_type)
+			continue;
+
+		clause = (cons_t*)((cons_t*)it.data.object)->car.data.object;
+		keys = clause->car;
+
+		if (keys.type == cons_type)
+		{
+			for (kt = keys; kt.type == cons_type; kt = ((cons_t*)kt.data.object)->cdr)
+			{
+				if (eql(((cons_t*)kt.data.object)->car, key))
+					break;
+			}
+			if (kt.type != cons_type)
+				continue;
+		}
+		else if (!case_is_default(keys) && !eql(keys, key))
+			continue;
+
+		release_ref(&key);
+		return eval_body_tail(clause->cdr, assoc, tail, result);
+	}
+
+	release_ref(&key);
+	*result = nil();
+	return 0;
+}
+
+ref_t slfe_case(ref_t args, ref_t assoc)
+{
+	return _eval_tail_form(slfe_case_tail, args, assoc);
+}
+
+/* (let* (binding...) body...), where each binding is either name or (name expr).
+   the bindings go in a new scope, and each expr can see the names bound before it */
+ref_t slfe_let_star(ref_t args, ref_t assoc)
+{
+	ref_t result, env, it, binding, name, val;
+	cons_t *cons;
+
+	if (args.type != cons_type)
+		return nil();
+
+	env = make_stack(assoc);
+
+	for (it = ((cons_t*)args.data.object)->car; it.type == cons_type; it = cons->cdr)
+	{
+		cons = (cons_t*)it.data.object;
+		binding = cons->car;
+
+		if (binding.type == symbol_type)
+			stack_let(env, binding, nil());
+		else if (binding.type == cons_type &&
+			((cons_t*)binding.data.object)->car.type == symbol_type)
+		{
+			name = ((cons_t*)binding.data.object)->car;
+			val = cadr(binding);
+			result = eval(val, env);
+			stack_let(env, name, result);
+			release_ref(&result);
+			release_ref(&val);
+		}
+		else
+			LOG_WARNING("let* binding is neither a name nor a (name expr) list");
+	}
+
+	result = eval_body(((cons_t*)args.data.object)->cdr, env);
+	release_ref(&env);
 
-	release_ref(&arge);
 	return result;
 }
 
+ref_t slfe_car(const ref_t *argv, size_t argc, ref_t env)
+{
+	return car(VARG(0));
+}
+
+ref_t slfe_cdr(const ref_t *argv, size_t argc, ref_t env)
+{
+	return cdr(VARG(0));
+}
+
+ref_t slfe_atom(const ref_t *argv, size_t argc, ref_t env)
+{
+	if (VARG(0).type == cons_type)
+		return nil();
+	else
+		return make_symbol("t", 0);
+}
+
 ref_t slfe_macro(ref_t args, ref_t assoc)
 {
 	ref_t result, param_list, code;
@@ -254,46 +500,69 @@ ref_t slfe_env_let(ref_t args, ref_t assoc)
 	return arge;
 }
 
-ref_t slfe_cons(ref_t args, ref_t assoc)
+/* (env-set-const name flag [env]) */
+ref_t slfe_env_set_const(ref_t args, ref_t assoc)
 {
-	ref_t result, arga, argae, argb, argbe;
+	ref_t name, namee, flag, flage, env, enve;
+
+	name = car(args);
+	namee = eval(name, assoc);
+	release_ref(&name);
+
+	flag = cadr(args);
+	flage = eval(flag, assoc);
+	release_ref(&flag);
 
-	arga = car(args);
-	argae = eval(arga, assoc);
-	release_ref(&arga);
+	env = caddr(args);
+	if (env.type != NIL)
+		enve = eval(env, assoc);
+	else
+		enve = clone_ref(assoc);
+	release_ref(&env);
 
-	argb = cadr(args);
-	argbe = eval(argb, assoc);
-	release_ref(&argb);
+	stack_set_const(enve, namee, flage.type != NIL);
 
-	result = make_cons(argae, argbe);
-	release_ref(&argae);
-	release_ref(&argbe);
+	release_ref(&namee);
+	release_ref(&enve);
 
-	return result;
+	return flage;
 }
 
-ref_t slfe_do(ref_t args, ref_t assoc)
+/* (env-is-const name [env]) */
+ref_t slfe_env_is_const(ref_t args, ref_t assoc)
 {
-	ref_t result, first, firste, rest;
+	ref_t result, name, namee, env, enve;
 
-	first = car(args);
-	firste = eval(first, assoc);
-	release_ref(&first);
+	name = car(args);
+	namee = eval(name, assoc);
+	release_ref(&name);
 
-	rest = cdr(args);
-	if (rest.type == NIL)
-	{
-		release_ref(&rest);
-		return firste;
-	}
+	env = cadr(args);
+	if (env.type != NIL)
+		enve = eval(env, assoc);
 	else
-	{
-		release_ref(&firste);
-		result = slfe_do(rest, assoc);
-		release_ref(&rest);
-		return result;
-	}
+		enve = clone_ref(assoc);
+	release_ref(&env);
+
+	if (stack_is_const(enve, namee))
+		result = make_symbol("t", 0);
+	else
+		result = nil();
+
+	release_ref(&namee);
+	release_ref(&enve);
+
+	return result;
+}
+
+ref_t slfe_cons(const ref_t *argv, size_t argc, ref_t env)
+{
+	return make_cons(VARG(0), VARG(1));
+}
+
+ref_t slfe_do(ref_t args, ref_t assoc)
+{
+	return _eval_tail_form(eval_body_tail, args, assoc);
 }
 
 ref_t slfe_scope(ref_t args, ref_t assoc)
@@ -342,65 +611,1648 @@ ref_t slfe_macro_expand(ref_t args, ref_t assoc)
 	return result;
 }
 
-ref_t slfe_closure_code(ref_t args, ref_t assoc)
+ref_t slfe_macro_expand_all(const ref_t *argv, size_t argc, ref_t env)
 {
-	ref_t result, fn, fne;
-	closure_t *cls;
-
-	fn = car(args);
-	fne = eval(fn, assoc);
-	release_ref(&fn);
+	return lexical_expand(VARG(0), env);
+}
 
-	cls = (closure_t*)fne.data.object;
-	result = clone_ref(cls->code);
-	release_ref(&fne);
+/* list library */
 
-	return result;
+/* follows path (the letters between the c and r of a c[ad]+r name) from the right, without cloning */
+static ref_t _cxr(ref_t l, const char *path, size_t len)
+{
+	while (len--)
+	{
+		if (l.type != cons_type)
+			return nil();
+		l = path[len] == 'a' ? ((cons_t*)l.data.object)->car : ((cons_t*)l.data.object)->cdr;
+	}
+	return clone_ref(l);
 }
 
-ref_t slfe_closure_env(ref_t args, ref_t assoc)
+#define DEFINE_CXR(n) \
+	static ref_t slfe_##n(const ref_t *argv, size_t argc, ref_t env) \
+	{ return _cxr(VARG(0), #n + 1, sizeof(#n) - 3); }
+
+DEFINE_CXR(caar) DEFINE_CXR(cadr) DEFINE_CXR(cdar) DEFINE_CXR(cddr)
+DEFINE_CXR(caaar) DEFINE_CXR(caadr) DEFINE_CXR(cadar) DEFINE_CXR(caddr)
+DEFINE_CXR(cdaar) DEFINE_CXR(cdadr) DEFINE_CXR(cddar) DEFINE_CXR(cdddr)
+DEFINE_CXR(caaaar) DEFINE_CXR(caaadr) DEFINE_CXR(caadar) DEFINE_CXR(caaddr)
+DEFINE_CXR(cadaar) DEFINE_CXR(cadadr) DEFINE_CXR(caddar) DEFINE_CXR(cadddr)
+DEFINE_CXR(cdaaar) DEFINE_CXR(cdaadr) DEFINE_CXR(cdadar) DEFINE_CXR(cdaddr)
+DEFINE_CXR(cddaar) DEFINE_CXR(cddadr) DEFINE_CXR(cdddar) DEFINE_CXR(cddddr)
+
+#undef DEFINE_CXR
+
+/* a list being built from the front.  make_cons won't make a cell that holds nil and nil,
+   so a list can't end with nil items; as with map_eval, nils are held back until
+   something follows them, and any left at the end are dropped */
+typedef struct list_builder_ts
 {
-	ref_t result, fn, fne;
-	closure_t *cls;
+	ref_t result;
+	ref_t *tail;
+	size_t nils; /* nil items held back */
+} list_builder_t;
 
-	fn = car(args);
-	fne = eval(fn, assoc);
-	release_ref(&fn);
+static void _list_init(list_builder_t *list)
+{
+	list->result = nil();
+	list->tail = &list->result;
+	list->nils = 0;
+}
 
-	cls = (closure_t*)fne.data.object;
-	result = clone_ref(cls->env);
-	release_ref(&fne);
+/* puts the held back nils and then rest (which it takes over) at the end of the list */
+static void _list_link(list_builder_t *list, ref_t rest)
+{
+	ref_t cell;
 
-	return result;
+	for (; list->nils; --list->nils)
+	{
+		cell = make_cons(nil(), rest);
+		release_ref(&rest);
+		rest = cell;
+	}
+	*list->tail = rest;
 }
 
-ref_t slfe_closure_plist(ref_t args, ref_t assoc)
+/* appends val (which it takes over) to the list */
+static void _push_tail(list_builder_t *list, ref_t val)
 {
-	ref_t result, fn, fne;
-	closure_t *cls;
+	ref_t cell;
+	ref_t *last;
 
-	fn = car(args);
-	fne = eval(fn, assoc);
-	release_ref(&fn);
+	if (val.type == NIL)
+	{
+		++list->nils;
+		return;
+	}
 
-	cls = (closure_t*)fne.data.object;
-	result = clone_ref(cls->param_list);
-	release_ref(&fne);
+	cell = make_cons(val, nil());
+	release_ref(&val);
+	last = &((cons_t*)cell.data.object)->cdr;
+	_list_link(list, cell);
+	list->tail = last;
+}
 
-	return result;
+/* ends the list with rest (which it takes over), and returns it */
+static ref_t _list_end(list_builder_t *list, ref_t rest)
+{
+	_list_link(list, rest);
+	return list->result;
 }
 
-ref_t slfe_make_closure(ref_t args, ref_t assoc)
+/* calls f with arguments that have already been evaluated.  functions get them bound
+   directly, and anything else gets them quoted, so that evaluating them again is harmless.
+   arg_cells is a list of cells that can be reused for the argument list (or nil) */
+static ref_t _call_values(ref_t f, const ref_t *argv, size_t argc, ref_t *arg_cells, ref_t env)
 {
-	ref_t result, plist, pliste, code, codee, env, enve;
+	ref_t result, it, quote;
+	size_t n, ncells;
 
-	plist = car(args);
-	pliste = eval(plist, assoc);
-	release_ref(&plist);
+	if (f.type == foreign_vexec_type)
+		return f.data.vfexec(argv, argc, env);
 
-	code = cadr(args);
-	codee = eval(code, assoc);
-	release_ref(&code);
+	quote = make_symbol("quote", 0);
+
+	/* a function gets the values themselves, and, as with map_eval, a list can't end with
+	   nils, so those are left off (quoted ones are never nil) */
+	ncells = argc;
+	if (f.type == function_type)
+	{
+		while (ncells && argv[ncells - 1].type == NIL)
+			--ncells;
+	}
+
+	/* if nothing held on to the cells (a &rest parameter gets a tail of them), they can be
+	   refilled instead of reallocated.  nb: make_cons won't make a cell that holds nil and nil,
+	   so they start off holding quote */
+	for (n = 0, it = *arg_cells; it.type == cons_type; ++n, it = ((cons_t*)it.data.object)->cdr)
+	{
+		if (it.data.object->rc != 1)
+			break;
+	}
+	if (n != ncells || it.type != NIL)
+	{
+		release_ref(arg_cells);
+		for (n = ncells; n; --n)
+		{
+			it = make_cons(quote, *arg_cells);
+			release_ref(arg_cells);
+			*arg_cells = it;
+		}
+	}
+
+	for (n = 0, it = *arg_cells; n != ncells; ++n, it = ((cons_t*)it.data.object)->cdr)
+	{
+		cons_t *cell = (cons_t*)it.data.object;
+		release_ref(&cell->car);
+		if (f.type == function_type)
+			cell->car = clone_ref(argv[n]);
+		else
+			cell->car = list(quote, argv[n]);
+	}
+	release_ref(&quote);
+
+	if (f.type == function_type)
+		result = apply(f, *arg_cells);
+	else
+		result = call(f, *arg_cells, env);
+
+	return result;
+}
+
+/* (length l) */
+ref_t slfe_length(const ref_t *argv, size_t argc, ref_t env)
+{
+	ref_t it;
+	int n = 0;
+
+	for (it = VARG(0); it.type == cons_type; it = ((cons_t*)it.data.object)->cdr)
+		++n;
+
+	return make_integer(n);
+}
+
+/* (append l...); every list but the last is copied, and the last is shared */
+ref_t slfe_append(const ref_t *argv, size_t argc, ref_t env)
+{
+	list_builder_t result;
+	ref_t it;
+	size_t n;
+
+	if (argc == 0)
+		return nil();
+
+	_list_init(&result);
+	for (n = 0; n + 1 < argc; ++n)
+	{
+		for (it = argv[n]; it.type == cons_type; it = ((cons_t*)it.data.object)->cdr)
+			_push_tail(&result, clone_ref(((cons_t*)it.data.object)->car));
+	}
+
+	return _list_end(&result, clone_ref(argv[argc - 1]));
+}
+
+/* (reverse l) */
+ref_t slfe_reverse(const ref_t *argv, size_t argc, ref_t env)
+{
+	ref_t result = nil(), it, cell;
+
+	for (it = VARG(0); it.type == cons_type; it = ((cons_t*)it.data.object)->cdr)
+	{
+		cell = make_cons(((cons_t*)it.data.object)->car, result);
+		release_ref(&result);
+		result = cell;
+	}
+
+	return result;
+}
+
+/* (nth n l); counts from 0, and gives nil past the end of the list */
+ref_t slfe_nth(const ref_t *argv, size_t argc, ref_t env)
+{
+	ref_t it;
+	int64_t n;
+
+	if (VARG(0).type != integer_type)
+		return nil();
+
+	n = VARG(0).data.integer;
+	for (it = VARG(1); n > 0 && it.type == cons_type; --n)
+		it = ((cons_t*)it.data.object)->cdr;
+
+	if (n < 0 || it.type != cons_type)
+		return nil();
+	return clone_ref(((cons_t*)it.data.object)->car);
+}
+
+/* (assoc key alist); returns the first (key . value) pair whose key is eql to key */
+ref_t slfe_assoc(const ref_t *argv, size_t argc, ref_t env)
+{
+	ref_t it, pair;
+
+	for (it = VARG(1); it.type == cons_type; it = ((cons_t*)it.data.object)->cdr)
+	{
+		pair = ((cons_t*)it.data.object)->car;
+		if (pair.type == cons_type && eql(((cons_t*)pair.data.object)->car, VARG(0)))
+			return clone_ref(pair);
+	}
+
+	return nil();
+}
+
+/* (member x l); returns the tail of l that starts with something eql to x */
+ref_t slfe_member(const ref_t *argv, size_t argc, ref_t env)
+{
+	ref_t it;
+
+	for (it = VARG(1); it.type == cons_type; it = ((cons_t*)it.data.object)->cdr)
+	{
+		if (eql(((cons_t*)it.data.object)->car, VARG(0)))
+			return clone_ref(it);
+	}
+
+	return nil();
+}
+
+/* vectors.  vector-ref, vector-set!, vector-length and vector->list also work on the
+   typed f64vectors and i64vectors */
+
+/* returns the vector argument as an sl_vector_t, or 0 if it isn't one */
+static sl_vector_t *_vector_arg(ref_t v)
+{
+	return v.type == vector_type ? (sl_vector_t*)v.data.object : 0;
+}
+
+/* returns the argument as an sl_numvec_t, or 0 if it isn't a typed vector */
+static sl_numvec_t *_numvec_arg(ref_t v)
+{
+	return (v.type == f64vector_type || v.type == i64vector_type) ? (sl_numvec_t*)v.data.object : 0;
+}
+
+/* returns the number of items in any kind of vector, or -1 if v isn't one */
+static int64_t _any_vector_length(ref_t v)
+{
+	if (v.type == vector_type)
+		return (int64_t)((sl_vector_t*)v.data.object)->items.size;
+	else if (_numvec_arg(v))
+		return (int64_t)((sl_numvec_t*)v.data.object)->size;
+	return -1;
+}
+
+/* returns 1 if i is an index into v, warning if it isn't */
+static int _vector_index_ok(ref_t v, ref_t i)
+{
+	if (i.type == integer_type && i.data.integer >= 0 && i.data.integer < _any_vector_length(v))
+		return 1;
+
+	LOG_WARNING("vector index out of range");
+	return 0;
+}
+
+/* sets item n of a typed vector to x; returns 0, with a warning, if x can't be stored in it */
+static int _numvec_store(ref_t v, size_t n, ref_t x)
+{
+	sl_numvec_t *vec = (sl_numvec_t*)v.data.object;
+
+	if (v.type == f64vector_type && x.type == real_type)
+		vec->items.f64[n] = x.data.real;
+	else if (v.type == f64vector_type && x.type == integer_type)
+		vec->items.f64[n] = (double)x.data.integer;
+	else if (v.type == i64vector_type && x.type == integer_type)
+		vec->items.i64[n] = x.data.integer;
+	else
+	{
+		LOG_WARNING("value can't be stored in a typed vector");
+		return 0;
+	}
+	return 1;
+}
+
+/* returns item n of a typed vector as a number */
+static ref_t _numvec_nth(ref_t v, size_t n)
+{
+	sl_numvec_t *vec = (sl_numvec_t*)v.data.object;
+
+	if (v.type == f64vector_type)
+		return make_real(vec->items.f64[n]);
+	return make_integer(vec->items.i64[n]);
+}
+
+/* (make-vector size [fill]) */
+ref_t slfe_make_vector(const ref_t *argv, size_t argc, ref_t env)
+{
+	if (VARG(0).type != integer_type || VARG(0).data.integer < 0)
+		return nil();
+	return make_sl_vector((size_t)VARG(0).data.integer, VARG(1));
+}
+
+/* (vector item...) */
+ref_t slfe_vector(const ref_t *argv, size_t argc, ref_t env)
+{
+	ref_t result;
+	size_t n;
+
+	result = make_sl_vector(argc, nil());
+	for (n = 0; n != argc; ++n)
+		SL_VECTOR_NTH((sl_vector_t*)result.data.object, n) = clone_ref(argv[n]);
+
+	return result;
+}
+
+/* (vector-ref v i) */
+ref_t slfe_vector_ref(const ref_t *argv, size_t argc, ref_t env)
+{
+	sl_vector_t *vec = _vector_arg(VARG(0));
+
+	if (!_vector_index_ok(VARG(0), VARG(1)))
+		return nil();
+	if (!vec)
+		return _numvec_nth(VARG(0), (size_t)VARG(1).data.integer);
+	return clone_ref(SL_VECTOR_NTH(vec, VARG(1).data.integer));
+}
+
+/* (vector-set! v i x); returns x */
+ref_t slfe_vector_set(const ref_t *argv, size_t argc, ref_t env)
+{
+	sl_vector_t *vec = _vector_arg(VARG(0));
+	ref_t old;
+
+	if (!_vector_index_ok(VARG(0), VARG(1)))
+		return nil();
+
+	if (!vec)
+	{
+		if (!_numvec_store(VARG(0), (size_t)VARG(1).data.integer, VARG(2)))
+			return nil();
+		return clone_ref(VARG(2));
+	}
+
+	old = SL_VECTOR_NTH(vec, VARG(1).data.integer);
+	SL_VECTOR_NTH(vec, VARG(1).data.integer) = clone_ref(VARG(2));
+	release_ref(&old);
+
+	return clone_ref(VARG(2));
+}
+
+/* (vector-length v) */
+ref_t slfe_vector_length(const ref_t *argv, size_t argc, ref_t env)
+{
+	int64_t length = _any_vector_length(VARG(0));
+
+	if (length < 0)
+		return nil();
+	return make_integer(length);
+}
+
+/* (vector->list v) */
+ref_t slfe_vector_to_list(const ref_t *argv, size_t argc, ref_t env)
+{
+	sl_vector_t *vec = _vector_arg(VARG(0));
+	list_builder_t result;
+	int64_t length = _any_vector_length(VARG(0));
+	size_t n;
+
+	_list_init(&result);
+	for (n = 0; (int64_t)n < length; ++n)
+		_push_tail(&result, vec ? clone_ref(SL_VECTOR_NTH(vec, n)) : _numvec_nth(VARG(0), n));
+
+	return _list_end(&result, nil());
+}
+
+/* (list->vector l) */
+ref_t slfe_list_to_vector(const ref_t *argv, size_t argc, ref_t env)
+{
+	return list_to_sl_vector(VARG(0));
+}
+
+/* typed vectors */
+
+/* makes a typed vector holding argc items, or returns nil if one of them isn't a suitable number */
+static ref_t _make_numvec(int is_f64, const ref_t *argv, size_t argc)
+{
+	ref_t result;
+	size_t n;
+
+	result = is_f64 ? make_f64vector(argc, 0.0) : make_i64vector(argc, 0);
+	for (n = 0; n != argc; ++n)
+	{
+		if (!_numvec_store(result, n, argv[n]))
+		{
+			release_ref(&result);
+			return nil();
+		}
+	}
+
+	return result;
+}
+
+/* makes a typed vector from the items of a list */
+static ref_t _list_to_numvec(int is_f64, ref_t list)
+{
+	ref_t result, it;
+	size_t size = 0, n;
+
+	for (it = list; it.type == cons_type; it = ((cons_t*)it.data.object)->cdr)
+		++size;
+
+	result = is_f64 ? make_f64vector(size, 0.0) : make_i64vector(size, 0);
+	for (it = list, n = 0; n != size; it = ((cons_t*)it.data.object)->cdr, ++n)
+	{
+		if (!_numvec_store(result, n, ((cons_t*)it.data.object)->car))
+		{
+			release_ref(&result);
+			return nil();
+		}
+	}
+
+	return result;
+}
+
+/* (make-f64vector size [fill]) */
+ref_t slfe_make_f64vector(const ref_t *argv, size_t argc, ref_t env)
+{
+	ref_t result;
+	size_t n;
+
+	if (VARG(0).type != integer_type || VARG(0).data.integer < 0)
+		return nil();
+
+	result = make_f64vector((size_t)VARG(0).data.integer, 0.0);
+	if (argc > 1 && VARG(0).data.integer > 0)
+	{
+		if (!_numvec_store(result, 0, VARG(1)))
+		{
+			release_ref(&result);
+			return nil();
+		}
+		for (n = 1; n != (size_t)VARG(0).data.integer; ++n)
+			((sl_numvec_t*)result.data.object)->items.f64[n] = ((sl_numvec_t*)result.data.object)->items.f64[0];
+	}
+
+	return result;
+}
+
+/* (make-i64vector size [fill]) */
+ref_t slfe_make_i64vector(const ref_t *argv, size_t argc, ref_t env)
+{
+	if (VARG(0).type != integer_type || VARG(0).data.integer < 0)
+		return nil();
+	if (argc > 1 && VARG(1).type != integer_type)
+	{
+		LOG_WARNING("value can't be stored in a typed vector");
+		return nil();
+	}
+	return make_i64vector((size_t)VARG(0).data.integer, argc > 1 ? VARG(1).data.integer : 0);
+}
+
+/* (f64vector x...) */
+ref_t slfe_f64vector(const ref_t *argv, size_t argc, ref_t env)
+{
+	return _make_numvec(1, argv, argc);
+}
+
+/* (i64vector x...) */
+ref_t slfe_i64vector(const ref_t *argv, size_t argc, ref_t env)
+{
+	return _make_numvec(0, argv, argc);
+}
+
+/* (list->f64vector l) */
+ref_t slfe_list_to_f64vector(const ref_t *argv, size_t argc, ref_t env)
+{
+	return _list_to_numvec(1, VARG(0));
+}
+
+/* (list->i64vector l) */
+ref_t slfe_list_to_i64vector(const ref_t *argv, size_t argc, ref_t env)
+{
+	return _list_to_numvec(0, VARG(0));
+}
+
+/* typed vector kernels.  each one takes vectors of a single type; the ones that take two
+   need them the same length */
+
+/* returns the typed vector argument, warning if it isn't one */
+static sl_numvec_t *_kernel_arg(ref_t v)
+{
+	sl_numvec_t *vec = _numvec_arg(v);
+	if (!vec)
+		LOG_WARNING("expected an f64vector or an i64vector");
+	return vec;
+}
+
+/* returns 1 if a and b are typed vectors of the same type and length, warning if they aren't */
+static int _kernel_args_match(ref_t a, ref_t b)
+{
+	if (!_kernel_arg(a) || !_kernel_arg(b))
+		return 0;
+	if (a.type != b.type || ((sl_numvec_t*)a.data.object)->size != ((sl_numvec_t*)b.data.object)->size)
+	{
+		LOG_WARNING("typed vectors differ in type or length");
+		return 0;
+	}
+	return 1;
+}
+
+/* returns 1 if a is a scalar that can multiply a vector of type type, warning if it isn't */
+static int _kernel_scalar_ok(const type_traits_t *type, ref_t a)
+{
+	if (a.type == integer_type || (a.type == real_type && type == f64vector_type))
+		return 1;
+	LOG_WARNING("scalar doesn't suit the typed vector");
+	return 0;
+}
+
+/* returns a new typed vector with the same type and length as v */
+static ref_t _numvec_like(ref_t v)
+{
+	size_t size = ((sl_numvec_t*)v.data.object)->size;
+	return v.type == f64vector_type ? make_f64vector(size, 0.0) : make_i64vector(size, 0);
+}
+
+#define NV(r) ((sl_numvec_t*)(r).data.object)
+#define SCALAR_F64(r) ((r).type == real_type ? (r).data.real : (double)(r).data.integer)
+
+/* (vsum v) */
+ref_t slfe_vsum(const ref_t *argv, size_t argc, ref_t env)
+{
+	if (!_kernel_arg(VARG(0)))
+		return nil();
+	if (VARG(0).type == f64vector_type)
+		return make_real(f64_sum(NV(VARG(0))->items.f64, NV(VARG(0))->size));
+	return make_integer(i64_sum(NV(VARG(0))->items.i64, NV(VARG(0))->size));
+}
+
+/* (vdot x y) */
+ref_t slfe_vdot(const ref_t *argv, size_t argc, ref_t env)
+{
+	if (!_kernel_args_match(VARG(0), VARG(1)))
+		return nil();
+	if (VARG(0).type == f64vector_type)
+		return make_real(f64_dot(NV(VARG(0))->items.f64, NV(VARG(1))->items.f64, NV(VARG(0))->size));
+	return make_integer(i64_dot(NV(VARG(0))->items.i64, NV(VARG(1))->items.i64, NV(VARG(0))->size));
+}
+
+/* (vscale a x); returns a new vector holding a*x */
+ref_t slfe_vscale(const ref_t *argv, size_t argc, ref_t env)
+{
+	ref_t result;
+
+	if (!_kernel_arg(VARG(1)) || !_kernel_scalar_ok(VARG(1).type, VARG(0)))
+		return nil();
+
+	result = _numvec_like(VARG(1));
+	if (VARG(1).type == f64vector_type)
+		f64_scale(NV(result)->items.f64, SCALAR_F64(VARG(0)), NV(VARG(1))->items.f64, NV(result)->size);
+	else
+		i64_scale(NV(result)->items.i64, VARG(0).data.integer, NV(VARG(1))->items.i64, NV(result)->size);
+	return result;
+}
+
+/* (vaxpy a x y); sets y to a*x + y in place and returns it */
+ref_t slfe_vaxpy(const ref_t *argv, size_t argc, ref_t env)
+{
+	if (!_kernel_args_match(VARG(1), VARG(2)) || !_kernel_scalar_ok(VARG(1).type, VARG(0)))
+		return nil();
+
+	if (VARG(1).type == f64vector_type)
+		f64_axpy(NV(VARG(2))->items.f64, SCALAR_F64(VARG(0)), NV(VARG(1))->items.f64, NV(VARG(1))->size);
+	else
+		i64_axpy(NV(VARG(2))->items.i64, VARG(0).data.integer, NV(VARG(1))->items.i64, NV(VARG(1))->size);
+	return clone_ref(VARG(2));
+}
+
+/* (vadd x y); returns a new vector of the elementwise sums */
+ref_t slfe_vadd(const ref_t *argv, size_t argc, ref_t env)
+{
+	ref_t result;
+
+	if (!_kernel_args_match(VARG(0), VARG(1)))
+		return nil();
+
+	result = _numvec_like(VARG(0));
+	if (VARG(0).type == f64vector_type)
+		f64_add(NV(result)->items.f64, NV(VARG(0))->items.f64, NV(VARG(1))->items.f64, NV(result)->size);
+	else
+		i64_add(NV(result)->items.i64, NV(VARG(0))->items.i64, NV(VARG(1))->items.i64, NV(result)->size);
+	return result;
+}
+
+/* (vmul x y); returns a new vector of the elementwise products */
+ref_t slfe_vmul(const ref_t *argv, size_t argc, ref_t env)
+{
+	ref_t result;
+
+	if (!_kernel_args_match(VARG(0), VARG(1)))
+		return nil();
+
+	result = _numvec_like(VARG(0));
+	if (VARG(0).type == f64vector_type)
+		f64_mul(NV(result)->items.f64, NV(VARG(0))->items.f64, NV(VARG(1))->items.f64, NV(result)->size);
+	else
+		i64_mul(NV(result)->items.i64, NV(VARG(0))->items.i64, NV(VARG(1))->items.i64, NV(result)->size);
+	return result;
+}
+
+/* (vmin v); nil for an empty vector */
+ref_t slfe_vmin(const ref_t *argv, size_t argc, ref_t env)
+{
+	if (!_kernel_arg(VARG(0)) || !NV(VARG(0))->size)
+		return nil();
+	if (VARG(0).type == f64vector_type)
+		return make_real(f64_min(NV(VARG(0))->items.f64, NV(VARG(0))->size));
+	return make_integer(i64_min(NV(VARG(0))->items.i64, NV(VARG(0))->size));
+}
+
+/* (vmax v); nil for an empty vector */
+ref_t slfe_vmax(const ref_t *argv, size_t argc, ref_t env)
+{
+	if (!_kernel_arg(VARG(0)) || !NV(VARG(0))->size)
+		return nil();
+	if (VARG(0).type == f64vector_type)
+		return make_real(f64_max(NV(VARG(0))->items.f64, NV(VARG(0))->size));
+	return make_integer(i64_max(NV(VARG(0))->items.i64, NV(VARG(0))->size));
+}
+
+/* (vprefix-sum v); returns a new vector of the running totals */
+ref_t slfe_vprefix_sum(const ref_t *argv, size_t argc, ref_t env)
+{
+	ref_t result;
+
+	if (!_kernel_arg(VARG(0)))
+		return nil();
+
+	result = _numvec_like(VARG(0));
+	if (VARG(0).type == f64vector_type)
+		f64_prefix_sum(NV(result)->items.f64, NV(VARG(0))->items.f64, NV(result)->size);
+	else
+		i64_prefix_sum(NV(result)->items.i64, NV(VARG(0))->items.i64, NV(result)->size);
+	return result;
+}
+
+#undef SCALAR_F64
+#undef NV
+
+/* hash tables */
+
+/* returns the hash table argument, warning if it isn't one */
+static sl_hash_table_t *_hash_table_arg(ref_t t)
+{
+	if (t.type != hash_table_type)
+	{
+		LOG_WARNING("expected a hash table");
+		return 0;
+	}
+	return (sl_hash_table_t*)t.data.object;
+}
+
+/* (make-hash-table [test]); test is eq or eql, and defaults to eql */
+ref_t slfe_make_hash_table(const ref_t *argv, size_t argc, ref_t env)
+{
+	ref_t eq_symbol;
+	int is_eql;
+
+	eq_symbol = make_symbol("eq", 0);
+	is_eql = !eq(VARG(0), eq_symbol);
+	release_ref(&eq_symbol);
+
+	return make_hash_table(is_eql);
+}
+
+/* (hash-get table key [default]) */
+ref_t slfe_hash_get(const ref_t *argv, size_t argc, ref_t env)
+{
+	sl_hash_table_t *table = _hash_table_arg(VARG(0));
+	hash_entry_t *e;
+
+	if (!table)
+		return nil();
+
+	e = hash_table_find(table, VARG(1));
+	return clone_ref(e ? e->value : VARG(2));
+}
+
+/* (hash-set! table key value); returns value */
+ref_t slfe_hash_set(const ref_t *argv, size_t argc, ref_t env)
+{
+	sl_hash_table_t *table = _hash_table_arg(VARG(0));
+
+	if (!table)
+		return nil();
+
+	hash_table_set(table, VARG(1), VARG(2));
+	return clone_ref(VARG(2));
+}
+
+/* (hash-remove! table key); returns t if there was an entry for key */
+ref_t slfe_hash_remove(const ref_t *argv, size_t argc, ref_t env)
+{
+	sl_hash_table_t *table = _hash_table_arg(VARG(0));
+
+	if (!table || !hash_table_remove(table, VARG(1)))
+		return nil();
+	return make_symbol("t", 0);
+}
+
+/* (hash-count table) */
+ref_t slfe_hash_count(const ref_t *argv, size_t argc, ref_t env)
+{
+	sl_hash_table_t *table = _hash_table_arg(VARG(0));
+
+	if (!table)
+		return nil();
+	return make_integer((int64_t)table->count);
+}
+
+/* the parts of each entry that _hash_table_list collects */
+#define HASH_KEYS (1)
+#define HASH_VALUES (2)
+
+/* returns a list of the keys, the values, or (key . value) pairs of every entry */
+static ref_t _hash_table_list(ref_t t, int parts)
+{
+	sl_hash_table_t *table = _hash_table_arg(t);
+	list_builder_t result;
+	ref_t key, value;
+	hash_table_iter_t it;
+
+	if (!table)
+		return nil();
+
+	_list_init(&result);
+	hash_table_iter_init(&it, table);
+	while (hash_table_iter_next(&it, &key, &value))
+	{
+		if (parts == HASH_KEYS)
+			_push_tail(&result, clone_ref(key));
+		else if (parts == HASH_VALUES)
+			_push_tail(&result, clone_ref(value));
+		else
+			_push_tail(&result, make_cons(key, value));
+	}
+
+	return _list_end(&result, nil());
+}
+
+/* (hash-keys table) */
+ref_t slfe_hash_keys(const ref_t *argv, size_t argc, ref_t env)
+{
+	return _hash_table_list(VARG(0), HASH_KEYS);
+}
+
+/* (hash-values table) */
+ref_t slfe_hash_values(const ref_t *argv, size_t argc, ref_t env)
+{
+	return _hash_table_list(VARG(0), HASH_VALUES);
+}
+
+/* (hash->list table); returns a list of (key . value) pairs */
+ref_t slfe_hash_to_list(const ref_t *argv, size_t argc, ref_t env)
+{
+	return _hash_table_list(VARG(0), HASH_KEYS | HASH_VALUES);
+}
+
+/* (hash-for-each f table); calls (f key value) for every entry.  the entries are collected
+   first, so f can change the table */
+ref_t slfe_hash_for_each(const ref_t *argv, size_t argc, ref_t env)
+{
+	ref_t keys, values, k, v, arg_cells = nil(), result, kv[2];
+
+	keys = _hash_table_list(VARG(1), HASH_KEYS);
+	values = _hash_table_list(VARG(1), HASH_VALUES);
+	for (k = keys, v = values; k.type == cons_type; k = ((cons_t*)k.data.object)->cdr, v = ((cons_t*)v.data.object)->cdr)
+	{
+		kv[0] = ((cons_t*)k.data.object)->car;
+		kv[1] = ((cons_t*)v.data.object)->car;
+		result = _call_values(VARG(0), kv, 2, &arg_cells, env);
+		release_ref(&result);
+	}
+	release_ref(&arg_cells);
+	release_ref(&values);
+	release_ref(&keys);
+
+	return nil();
+}
+
+#undef HASH_VALUES
+#undef HASH_KEYS
+
+/* sorted maps */
+
+/* returns the sorted map argument, warning if it isn't one */
+static sl_sorted_map_t *_sorted_map_arg(ref_t m)
+{
+	if (m.type != sorted_map_type)
+	{
+		LOG_WARNING("expected a sorted map");
+		return 0;
+	}
+	return (sl_sorted_map_t*)m.data.object;
+}
+
+/* returns 1 if key can be a sorted map key, warning if it can't */
+static int _sorted_map_key_arg(ref_t key)
+{
+	if (sorted_map_key_ok(key))
+		return 1;
+	LOG_WARNING("sorted map keys must be integers, reals, strings or symbols");
+	return 0;
+}
+
+/* returns the (key . value) pair held by a node, or nil for no node */
+static ref_t _sorted_map_pair(rbtn_t *node)
+{
+	if (!node)
+		return nil();
+	return make_cons(SORTED_MAP_ENTRY(node)->key, SORTED_MAP_ENTRY(node)->value);
+}
+
+/* (make-sorted-map) */
+ref_t slfe_make_sorted_map(const ref_t *argv, size_t argc, ref_t env)
+{
+	return make_sorted_map();
+}
+
+/* (sorted-map-put m key value); returns value */
+ref_t slfe_sorted_map_put(const ref_t *argv, size_t argc, ref_t env)
+{
+	sl_sorted_map_t *map = _sorted_map_arg(VARG(0));
+
+	if (!map || !_sorted_map_key_arg(VARG(1)))
+		return nil();
+
+	sorted_map_put(map, VARG(1), VARG(2));
+	return clone_ref(VARG(2));
+}
+
+/* (sorted-map-get m key [default]) */
+ref_t slfe_sorted_map_get(const ref_t *argv, size_t argc, ref_t env)
+{
+	sl_sorted_map_t *map = _sorted_map_arg(VARG(0));
+	sorted_map_entry_t *e;
+
+	if (!map)
+		return nil();
+
+	e = sorted_map_find(map, VARG(1));
+	return clone_ref(e ? e->value : VARG(2));
+}
+
+/* (sorted-map-delete m key); returns t if there was an entry for key */
+ref_t slfe_sorted_map_delete(const ref_t *argv, size_t argc, ref_t env)
+{
+	sl_sorted_map_t *map = _sorted_map_arg(VARG(0));
+
+	if (!map || !sorted_map_delete(map, VARG(1)))
+		return nil();
+	return make_symbol("t", 0);
+}
+
+/* (sorted-map-count m) */
+ref_t slfe_sorted_map_count(const ref_t *argv, size_t argc, ref_t env)
+{
+	sl_sorted_map_t *map = _sorted_map_arg(VARG(0));
+
+	if (!map)
+		return nil();
+	return make_integer((int64_t)map->count);
+}
+
+/* (sorted-map-floor m key); returns the (key . value) pair with the greatest key not above key */
+ref_t slfe_sorted_map_floor(const ref_t *argv, size_t argc, ref_t env)
+{
+	sl_sorted_map_t *map = _sorted_map_arg(VARG(0));
+
+	if (!map || !_sorted_map_key_arg(VARG(1)))
+		return nil();
+	return _sorted_map_pair(sorted_map_floor(map, VARG(1)));
+}
+
+/* (sorted-map-ceiling m key); returns the (key . value) pair with the least key not below key */
+ref_t slfe_sorted_map_ceiling(const ref_t *argv, size_t argc, ref_t env)
+{
+	sl_sorted_map_t *map = _sorted_map_arg(VARG(0));
+
+	if (!map || !_sorted_map_key_arg(VARG(1)))
+		return nil();
+	return _sorted_map_pair(sorted_map_ceiling(map, VARG(1)));
+}
+
+/* returns the (key . value) pairs with lo <= key < hi, in key order.  a nil bound
+   leaves that end of the range open */
+static ref_t _sorted_map_range(ref_t m, ref_t lo, ref_t hi)
+{
+	sl_sorted_map_t *map = _sorted_map_arg(m);
+	list_builder_t result;
+	rbtn_t *node;
+
+	if (!map || (lo.type != NIL && !_sorted_map_key_arg(lo)) || (hi.type != NIL && !_sorted_map_key_arg(hi)))
+		return nil();
+
+	_list_init(&result);
+	node = (lo.type == NIL) ? rbtn_first(map->root) : sorted_map_ceiling(map, lo);
+	for (; node; node = rbtn_next(node))
+	{
+		if (hi.type != NIL && sorted_map_compare_keys(SORTED_MAP_ENTRY(node)->key, hi) >= 0)
+			break;
+		_push_tail(&result, _sorted_map_pair(node));
+	}
+
+	return _list_end(&result, nil());
+}
+
+/* (sorted-map-range m [lo [hi]]); returns the (key . value) pairs with lo <= key < hi, in order */
+ref_t slfe_sorted_map_range(const ref_t *argv, size_t argc, ref_t env)
+{
+	return _sorted_map_range(VARG(0), VARG(1), VARG(2));
+}
+
+/* (sorted-map-for-each f m [lo [hi]]); calls (f key value) for each entry with lo <= key < hi,
+   in key order.  the entries are collected first, so f can change the map */
+ref_t slfe_sorted_map_for_each(const ref_t *argv, size_t argc, ref_t env)
+{
+	ref_t pairs, it, arg_cells = nil(), result, kv[2];
+
+	pairs = _sorted_map_range(VARG(1), VARG(2), VARG(3));
+	for (it = pairs; it.type == cons_type; it = ((cons_t*)it.data.object)->cdr)
+	{
+		cons_t *pair = (cons_t*)((cons_t*)it.data.object)->car.data.object;
+		kv[0] = pair->car;
+		kv[1] = pair->cdr;
+		result = _call_values(VARG(0), kv, 2, &arg_cells, env);
+		release_ref(&result);
+	}
+	release_ref(&arg_cells);
+	release_ref(&pairs);
+
+	return nil();
+}
+
+/* persistent vectors and maps.  the functions ending in ! change a transient in place and
+   return it; the others leave their argument alone, and return a new persistent version
+   that shares most of its nodes */
+
+/* returns the pvec argument, warning if it isn't one that can still be used */
+static sl_pvec_t *_pvec_arg(ref_t v)
+{
+	if (v.type != pvec_type)
+	{
+		LOG_WARNING("expected a pvec");
+		return 0;
+	}
+	if (((sl_pvec_t*)v.data.object)->state == PVEC_FINISHED)
+	{
+		LOG_WARNING("transient used after persistent!");
+		return 0;
+	}
+	return (sl_pvec_t*)v.data.object;
+}
+
+/* returns the pvec argument of a change, warning if it isn't a transient one when in_place */
+static sl_pvec_t *_pvec_change_arg(ref_t v, int in_place)
+{
+	sl_pvec_t *vec = _pvec_arg(v);
+
+	if (vec && in_place && vec->state != PVEC_TRANSIENT)
+	{
+		LOG_WARNING("expected a transient pvec");
+		return 0;
+	}
+	return vec;
+}
+
+/* returns the vector a change to v goes into: v itself when in_place, or else a new version */
+static ref_t _pvec_target(ref_t v, int in_place)
+{
+	if (in_place)
+		return clone_ref(v);
+	return pvec_copy((sl_pvec_t*)v.data.object, PVEC_PERSISTENT);
+}
+
+/* returns 1 if i is an index into vec, warning if it isn't */
+static int _pvec_index_ok(sl_pvec_t *vec, ref_t i)
+{
+	if (i.type == integer_type && i.data.integer >= 0 && (uint64_t)i.data.integer < vec->count)
+		return 1;
+
+	LOG_WARNING("pvec index out of range");
+	return 0;
+}
+
+/* (pvec item...) */
+ref_t slfe_pvec(const ref_t *argv, size_t argc, ref_t env)
+{
+	ref_t result = make_pvec();
+	size_t n;
+
+	/* nothing else has seen the new vector yet, so it's built in place */
+	for (n = 0; n != argc; ++n)
+		pvec_push((sl_pvec_t*)result.data.object, argv[n]);
+
+	return result;
+}
+
+/* (list->pvec l) */
+ref_t slfe_list_to_pvec(const ref_t *argv, size_t argc, ref_t env)
+{
+	ref_t result = make_pvec(), it;
+
+	for (it = VARG(0); it.type == cons_type; it = ((cons_t*)it.data.object)->cdr)
+		pvec_push((sl_pvec_t*)result.data.object, ((cons_t*)it.data.object)->car);
+
+	return result;
+}
+
+/* (pvec->list v) */
+ref_t slfe_pvec_to_list(const ref_t *argv, size_t argc, ref_t env)
+{
+	sl_pvec_t *vec = _pvec_arg(VARG(0));
+	list_builder_t result;
+	size_t n;
+
+	if (!vec)
+		return nil();
+
+	_list_init(&result);
+	for (n = 0; n != vec->count; ++n)
+		_push_tail(&result, clone_ref(pvec_nth(vec, n)));
+
+	return _list_end(&result, nil());
+}
+
+/* (pvec-length v) */
+ref_t slfe_pvec_length(const ref_t *argv, size_t argc, ref_t env)
+{
+	sl_pvec_t *vec = _pvec_arg(VARG(0));
+
+	if (!vec)
+		return nil();
+	return make_integer((int64_t)vec->count);
+}
+
+/* (pvec-ref v i) */
+ref_t slfe_pvec_ref(const ref_t *argv, size_t argc, ref_t env)
+{
+	sl_pvec_t *vec = _pvec_arg(VARG(0));
+
+	if (!vec || !_pvec_index_ok(vec, VARG(1)))
+		return nil();
+	return clone_ref(pvec_nth(vec, (size_t)VARG(1).data.integer));
+}
+
+static ref_t _pvec_set(const ref_t *argv, size_t argc, int in_place)
+{
+	sl_pvec_t *vec = _pvec_change_arg(VARG(0), in_place);
+	ref_t result;
+
+	if (!vec || !_pvec_index_ok(vec, VARG(1)))
+		return nil();
+
+	result = _pvec_target(VARG(0), in_place);
+	pvec_set((sl_pvec_t*)result.data.object, (size_t)VARG(1).data.integer, VARG(2));
+	return result;
+}
+
+static ref_t _pvec_push(const ref_t *argv, size_t argc, int in_place)
+{
+	ref_t result;
+
+	if (!_pvec_change_arg(VARG(0), in_place))
+		return nil();
+
+	result = _pvec_target(VARG(0), in_place);
+	pvec_push((sl_pvec_t*)result.data.object, VARG(1));
+	return result;
+}
+
+static ref_t _pvec_pop(const ref_t *argv, size_t argc, int in_place)
+{
+	sl_pvec_t *vec = _pvec_change_arg(VARG(0), in_place);
+	ref_t result;
+
+	if (!vec)
+		return nil();
+	if (!vec->count)
+	{
+		LOG_WARNING("pvec is empty");
+		return nil();
+	}
+
+	result = _pvec_target(VARG(0), in_place);
+	pvec_pop((sl_pvec_t*)result.data.object);
+	return result;
+}
+
+/* (pvec-set v i x) */
+ref_t slfe_pvec_set(const ref_t *argv, size_t argc, ref_t env)
+{
+	return _pvec_set(argv, argc, 0);
+}
+
+/* (pvec-push v x); adds x to the end */
+ref_t slfe_pvec_push(const ref_t *argv, size_t argc, ref_t env)
+{
+	return _pvec_push(argv, argc, 0);
+}
+
+/* (pvec-pop v); drops the last item */
+ref_t slfe_pvec_pop(const ref_t *argv, size_t argc, ref_t env)
+{
+	return _pvec_pop(argv, argc, 0);
+}
+
+/* (pvec-set! t i x) */
+ref_t slfe_pvec_set_in_place(const ref_t *argv, size_t argc, ref_t env)
+{
+	return _pvec_set(argv, argc, 1);
+}
+
+/* (pvec-push! t x) */
+ref_t slfe_pvec_push_in_place(const ref_t *argv, size_t argc, ref_t env)
+{
+	return _pvec_push(argv, argc, 1);
+}
+
+/* (pvec-pop! t) */
+ref_t slfe_pvec_pop_in_place(const ref_t *argv, size_t argc, ref_t env)
+{
+	return _pvec_pop(argv, argc, 1);
+}
+
+/* returns the pmap argument, warning if it isn't one that can still be used */
+static sl_pmap_t *_pmap_arg(ref_t m)
+{
+	if (m.type != pmap_type)
+	{
+		LOG_WARNING("expected a pmap");
+		return 0;
+	}
+	if (((sl_pmap_t*)m.data.object)->state == PMAP_FINISHED)
+	{
+		LOG_WARNING("transient used after persistent!");
+		return 0;
+	}
+	return (sl_pmap_t*)m.data.object;
+}
+
+/* returns the pmap argument of a change, warning if it isn't a transient one when in_place */
+static sl_pmap_t *_pmap_change_arg(ref_t m, int in_place)
+{
+	sl_pmap_t *map = _pmap_arg(m);
+
+	if (map && in_place && map->state != PMAP_TRANSIENT)
+	{
+		LOG_WARNING("expected a transient pmap");
+		return 0;
+	}
+	return map;
+}
+
+/* returns the map a change to m goes into: m itself when in_place, or else a new version */
+static ref_t _pmap_target(ref_t m, int in_place)
+{
+	if (in_place)
+		return clone_ref(m);
+	return pmap_copy((sl_pmap_t*)m.data.object, PMAP_PERSISTENT);
+}
+
+/* (pmap key value...) */
+ref_t slfe_pmap(const ref_t *argv, size_t argc, ref_t env)
+{
+	ref_t result;
+	size_t n;
+
+	if (argc % 2)
+		LOG_WARNING("pmap needs a value for each key");
+
+	/* nothing else has seen the new map yet, so it's built in place */
+	result = make_pmap();
+	for (n = 0; n + 1 < argc; n += 2)
+		pmap_set((sl_pmap_t*)result.data.object, argv[n], argv[n + 1]);
+
+	return result;
+}
+
+/* (alist->pmap l); l is a list of (key . value) pairs.  a key's first pair wins, as it
+   does for assoc */
+ref_t slfe_alist_to_pmap(const ref_t *argv, size_t argc, ref_t env)
+{
+	ref_t result = make_pmap(), it, pair;
+	sl_pmap_t *map = (sl_pmap_t*)result.data.object;
+
+	for (it = VARG(0); it.type == cons_type; it = ((cons_t*)it.data.object)->cdr)
+	{
+		pair = ((cons_t*)it.data.object)->car;
+		if (pair.type != cons_type)
+			continue;
+		if (!pmap_find(map, ((cons_t*)pair.data.object)->car))
+			pmap_set(map, ((cons_t*)pair.data.object)->car, ((cons_t*)pair.data.object)->cdr);
+	}
+
+	return result;
+}
+
+/* (pmap-get m key [default]) */
+ref_t slfe_pmap_get(const ref_t *argv, size_t argc, ref_t env)
+{
+	sl_pmap_t *map = _pmap_arg(VARG(0));
+	ref_t *value;
+
+	if (!map)
+		return nil();
+
+	value = pmap_find(map, VARG(1));
+	return clone_ref(value ? *value : VARG(2));
+}
+
+/* (pmap-count m) */
+ref_t slfe_pmap_count(const ref_t *argv, size_t argc, ref_t env)
+{
+	sl_pmap_t *map = _pmap_arg(VARG(0));
+
+	if (!map)
+		return nil();
+	return make_integer((int64_t)map->count);
+}
+
+static ref_t _pmap_set(const ref_t *argv, size_t argc, int in_place)
+{
+	ref_t result;
+
+	if (!_pmap_change_arg(VARG(0), in_place))
+		return nil();
+
+	result = _pmap_target(VARG(0), in_place);
+	pmap_set((sl_pmap_t*)result.data.object, VARG(1), VARG(2));
+	return result;
+}
+
+static ref_t _pmap_remove(const ref_t *argv, size_t argc, int in_place)
+{
+	ref_t result;
+
+	if (!_pmap_change_arg(VARG(0), in_place))
+		return nil();
+
+	result = _pmap_target(VARG(0), in_place);
+	pmap_remove((sl_pmap_t*)result.data.object, VARG(1));
+	return result;
+}
+
+/* (pmap-set m key value) */
+ref_t slfe_pmap_set(const ref_t *argv, size_t argc, ref_t env)
+{
+	return _pmap_set(argv, argc, 0);
+}
+
+/* (pmap-remove m key) */
+ref_t slfe_pmap_remove(const ref_t *argv, size_t argc, ref_t env)
+{
+	return _pmap_remove(argv, argc, 0);
+}
+
+/* (pmap-set! t key value) */
+ref_t slfe_pmap_set_in_place(const ref_t *argv, size_t argc, ref_t env)
+{
+	return _pmap_set(argv, argc, 1);
+}
+
+/* (pmap-remove! t key) */
+ref_t slfe_pmap_remove_in_place(const ref_t *argv, size_t argc, ref_t env)
+{
+	return _pmap_remove(argv, argc, 1);
+}
+
+/* the parts of each entry that _pmap_list collects */
+#define PMAP_KEYS (1)
+#define PMAP_VALUES (2)
+
+typedef struct pmap_list_ts
+{
+	list_builder_t result;
+	int parts;
+} pmap_list_t;
+
+static void _pmap_list_entry(ref_t key, ref_t value, void *data)
+{
+	pmap_list_t *list = (pmap_list_t*)data;
+
+	if (list->parts == PMAP_KEYS)
+		_push_tail(&list->result, clone_ref(key));
+	else if (list->parts == PMAP_VALUES)
+		_push_tail(&list->result, clone_ref(value));
+	else
+		_push_tail(&list->result, make_cons(key, value));
+}
+
+/* returns a list of the keys, the values, or (key . value) pairs of every entry */
+static ref_t _pmap_list(ref_t m, int parts)
+{
+	sl_pmap_t *map = _pmap_arg(m);
+	pmap_list_t list;
+
+	if (!map)
+		return nil();
+
+	_list_init(&list.result);
+	list.parts = parts;
+	pmap_for_each(map, _pmap_list_entry, &list);
+
+	return _list_end(&list.result, nil());
+}
+
+/* (pmap-keys m) */
+ref_t slfe_pmap_keys(const ref_t *argv, size_t argc, ref_t env)
+{
+	return _pmap_list(VARG(0), PMAP_KEYS);
+}
+
+/* (pmap-values m) */
+ref_t slfe_pmap_values(const ref_t *argv, size_t argc, ref_t env)
+{
+	return _pmap_list(VARG(0), PMAP_VALUES);
+}
+
+/* (pmap->list m); returns a list of (key . value) pairs */
+ref_t slfe_pmap_to_list(const ref_t *argv, size_t argc, ref_t env)
+{
+	return _pmap_list(VARG(0), PMAP_KEYS | PMAP_VALUES);
+}
+
+/* (pmap-for-each f m); calls (f key value) for every entry */
+ref_t slfe_pmap_for_each(const ref_t *argv, size_t argc, ref_t env)
+{
+	ref_t keys, values, k, v, arg_cells = nil(), result, kv[2];
+
+	keys = _pmap_list(VARG(1), PMAP_KEYS);
+	values = _pmap_list(VARG(1), PMAP_VALUES);
+	for (k = keys, v = values; k.type == cons_type; k = ((cons_t*)k.data.object)->cdr, v = ((cons_t*)v.data.object)->cdr)
+	{
+		kv[0] = ((cons_t*)k.data.object)->car;
+		kv[1] = ((cons_t*)v.data.object)->car;
+		result = _call_values(VARG(0), kv, 2, &arg_cells, env);
+		release_ref(&result);
+	}
+	release_ref(&arg_cells);
+	release_ref(&values);
+	release_ref(&keys);
+
+	return nil();
+}
+
+#undef PMAP_VALUES
+#undef PMAP_KEYS
+
+/* (transient x); returns a transient copy of a pvec or pmap, which the ! functions change
+   in place.  its nodes are shared with x until they're changed */
+ref_t slfe_transient(const ref_t *argv, size_t argc, ref_t env)
+{
+	sl_pvec_t *vec;
+	sl_pmap_t *map;
+
+	if (VARG(0).type == pvec_type)
+		return (vec = _pvec_arg(VARG(0))) ? pvec_copy(vec, PVEC_TRANSIENT) : nil();
+	else if (VARG(0).type == pmap_type)
+		return (map = _pmap_arg(VARG(0))) ? pmap_copy(map, PMAP_TRANSIENT) : nil();
+
+	LOG_WARNING("expected a pvec or a pmap");
+	return nil();
+}
+
+/* (persistent! t); returns a persistent version of a transient, which can't be used after */
+ref_t slfe_persistent(const ref_t *argv, size_t argc, ref_t env)
+{
+	sl_pvec_t *vec;
+	sl_pmap_t *map;
+	ref_t result;
+
+	if (VARG(0).type == pvec_type)
+	{
+		if (!(vec = _pvec_change_arg(VARG(0), 1)))
+			return nil();
+		result = pvec_copy(vec, PVEC_PERSISTENT);
+		pvec_finish(vec);
+		return result;
+	}
+	else if (VARG(0).type == pmap_type)
+	{
+		if (!(map = _pmap_change_arg(VARG(0), 1)))
+			return nil();
+		result = pmap_copy(map, PMAP_PERSISTENT);
+		pmap_finish(map);
+		return result;
+	}
+
+	LOG_WARNING("expected a transient pvec or pmap");
+	return nil();
+}
+
+/* structs */
+
+/* returns the symbol prefix + a + infix + b + suffix; b can be nil */
+static ref_t _struct_symbol(const char *prefix, ref_t a, const char *infix, ref_t b, const char *suffix)
+{
+	string_t *as = a.data.symb->name, *bs = b.type == symbol_type ? b.data.symb->name : 0;
+	size_t len;
+	char *buf;
+	ref_t result;
+
+	len = strlen(prefix) + as->len + strlen(infix) + (bs ? bs->len : 0) + strlen(suffix);
+	buf = (char*)X_MALLOC(len + 1);
+
+	strcpy(buf, prefix);
+	strncat(buf, string_c_str(as), as->len);
+	strcat(buf, infix);
+	if (bs)
+		strncat(buf, string_c_str(bs), bs->len);
+	strcat(buf, suffix);
+
+	result = make_symbol(buf, len);
+	X_FREE(buf);
+	return result;
+}
+
+/* binds name to a new struct procedure in env; takes over name */
+static void _struct_proc_let(ref_t env, ref_t desc, struct_proc_kind_t kind, size_t index, ref_t name)
+{
+	ref_t proc = make_struct_proc(desc, kind, index, name);
+	stack_let(env, name, proc);
+	release_ref(&proc);
+	release_ref(&name);
+}
+
+/* (defstruct name field...); defines make-name, name?, and name-field and set-name-field!
+   for each field, in the calling environment.  returns name */
+ref_t slfe_defstruct(ref_t args, ref_t assoc)
+{
+	ref_t name, fields, it, desc;
+	size_t n;
+
+	name = car(args);
+	fields = cdr(args);
+
+	if (name.type != symbol_type)
+	{
+		LOG_WARNING("defstruct needs a symbol for the struct's name");
+		release_ref(&name);
+		release_ref(&fields);
+		return nil();
+	}
+	for (it = fields; it.type == cons_type; it = ((cons_t*)it.data.object)->cdr)
+	{
+		if (((cons_t*)it.data.object)->car.type != symbol_type)
+		{
+			LOG_WARNING("defstruct needs symbols for the struct's fields");
+			release_ref(&name);
+			release_ref(&fields);
+			return nil();
+		}
+	}
+
+	desc = make_struct_desc(name, fields);
+
+	_struct_proc_let(assoc, desc, STRUCT_PROC_MAKE, 0, _struct_symbol("make-", name, "", nil(), ""));
+	_struct_proc_let(assoc, desc, STRUCT_PROC_TEST, 0, _struct_symbol("", name, "", nil(), "?"));
+	for (n = 0, it = fields; it.type == cons_type; ++n, it = ((cons_t*)it.data.object)->cdr)
+	{
+		ref_t field = ((cons_t*)it.data.object)->car;
+		_struct_proc_let(assoc, desc, STRUCT_PROC_GET, n, _struct_symbol("", name, "-", field, ""));
+		_struct_proc_let(assoc, desc, STRUCT_PROC_SET, n, _struct_symbol("set-", name, "-", field, "!"));
+	}
+
+	release_ref(&desc);
+	release_ref(&fields);
+
+	return name;
+}
+
+/* mapcar keeps its list pointers on the C stack when it is given this many lists or fewer */
+#define MAPCAR_LOCAL_LISTS (4)
+
+/* (mapcar f l...); stops at the end of the shortest list */
+ref_t slfe_mapcar(const ref_t *argv, size_t argc, ref_t env)
+{
+	list_builder_t result;
+	ref_t arg_cells = nil();
+	ref_t local_its[MAPCAR_LOCAL_LISTS * 2], *its, *vals;
+	size_t n, nlists;
+
+	if (argc < 2)
+		return nil();
+
+	/* the lists being walked, followed by the current element of each */
+	nlists = argc - 1;
+	if (nlists <= MAPCAR_LOCAL_LISTS)
+		its = local_its;
+	else
+		its = (ref_t*)X_MALLOC(sizeof(ref_t) * nlists * 2);
+	vals = its + nlists;
+
+	for (n = 0; n != nlists; ++n)
+		its[n] = argv[n + 1];
+
+	_list_init(&result);
+	for (;;)
+	{
+		for (n = 0; n != nlists; ++n)
+		{
+			if (its[n].type != cons_type)
+				break;
+			vals[n] = ((cons_t*)its[n].data.object)->car;
+			its[n] = ((cons_t*)its[n].data.object)->cdr;
+		}
+		if (n != nlists)
+			break;
+
+		_push_tail(&result, _call_values(argv[0], vals, nlists, &arg_cells, env));
+	}
+
+	release_ref(&arg_cells);
+	if (its != local_its)
+	{
+		X_FREE(its);
+	}
+
+	return _list_end(&result, nil());
+}
+
+/* (filter pred l); the elements of l that pred returns non-nil for */
+ref_t slfe_filter(const ref_t *argv, size_t argc, ref_t env)
+{
+	list_builder_t result;
+	ref_t arg_cells = nil(), it, test;
+
+	_list_init(&result);
+	for (it = VARG(1); it.type == cons_type; it = ((cons_t*)it.data.object)->cdr)
+	{
+		test = _call_values(VARG(0), &((cons_t*)it.data.object)->car, 1, &arg_cells, env);
+		if (test.type != NIL)
+			_push_tail(&result, clone_ref(((cons_t*)it.data.object)->car));
+		release_ref(&test);
+	}
+
+	release_ref(&arg_cells);
+	return _list_end(&result, nil());
+}
+
+/* (foldl f init l); calls (f acc x) for each x in l, starting with acc = init */
+ref_t slfe_foldl(const ref_t *argv, size_t argc, ref_t env)
+{
+	ref_t acc, arg_cells = nil(), it, pair[2];
+
+	acc = clone_ref(VARG(1));
+	for (it = VARG(2); it.type == cons_type; it = ((cons_t*)it.data.object)->cdr)
+	{
+		pair[0] = acc;
+		pair[1] = ((cons_t*)it.data.object)->car;
+		acc = _call_values(VARG(0), pair, 2, &arg_cells, env);
+		release_ref(&pair[0]);
+	}
+
+	release_ref(&arg_cells);
+	return acc;
+}
+
+ref_t slfe_closure_code(ref_t args, ref_t assoc)
+{
+	ref_t result, fn, fne;
+	closure_t *cls;
+
+	fn = car(args);
+	fne = eval(fn, assoc);
+	release_ref(&fn);
+
+	cls = (closure_t*)fne.data.object;
+	result = clone_ref(cls->code);
+	release_ref(&fne);
+
+	return result;
+}
+
+ref_t slfe_closure_env(ref_t args, ref_t assoc)
+{
+	ref_t result, fn, fne;
+	closure_t *cls;
+
+	fn = car(args);
+	fne = eval(fn, assoc);
+	release_ref(&fn);
+
+	cls = (closure_t*)fne.data.object;
+	result = clone_ref(cls->env);
+	release_ref(&fne);
+
+	return result;
+}
+
+ref_t slfe_closure_plist(ref_t args, ref_t assoc)
+{
+	ref_t result, fn, fne;
+	closure_t *cls;
+
+	fn = car(args);
+	fne = eval(fn, assoc);
+	release_ref(&fn);
+
+	cls = (closure_t*)fne.data.object;
+	result = clone_ref(cls->param_list);
+	release_ref(&fne);
+
+	return result;
+}
+
+ref_t slfe_make_closure(ref_t args, ref_t assoc)
+{
+	ref_t result, plist, pliste, code, codee, env, enve;
+
+	plist = car(args);
+	pliste = eval(plist, assoc);
+	release_ref(&plist);
+
+	code = cadr(args);
+	codee = eval(code, assoc);
+	release_ref(&code);
 
 	env = caddr(args);
 	enve = eval(env, assoc);
@@ -473,213 +2325,348 @@ ref_t slfe_type(ref_t args, ref_t assoc)
 	return result;
 }
 
-ref_t slfe_add(ref_t args, ref_t assoc)
+/* arithmetic.  integers are 64 bits; an operation on two integers that would overflow,
+   or on an integer and a real, is done with reals instead */
+
+typedef struct number_ts
 {
-	ref_t a, ae, b, be, result;
-	a = car(args);
-	ae = eval(a, assoc);
-	release_ref(&a);
-	b = cadr(args);
-	be = eval(b, assoc);
-	release_ref(&b);
+	int is_real;
+	int64_t i;
+	double r;
+} number_t;
 
-	if (ae.type != be.type)
-		result = nil();
-	else
+/* returns 0 if ref isn't a number */
+static int _get_number(ref_t ref, number_t *n)
+{
+	if (ref.type == integer_type)
 	{
-		if (ae.type == integer_type)
-			result = make_integer(ae.data.integer + be.data.integer);
-		else if (ae.type == real_type)
-			result = make_real(ae.data.real + be.data.real);
-		else
-			result = nil();
+		n->is_real = 0;
+		n->i = ref.data.integer;
+		n->r = 0.0;
+		return 1;
+	}
+	else if (ref.type == real_type)
+	{
+		n->is_real = 1;
+		n->i = 0;
+		n->r = ref.data.real;
+		return 1;
 	}
+	return 0;
+}
 
-	release_ref(&ae);
-	release_ref(&be);
-	return result;
+static double _as_real(const number_t *n)
+{
+	return n->is_real ? n->r : (double)n->i;
 }
 
-ref_t slfe_sub(ref_t args, ref_t assoc)
+static ref_t _make_number(const number_t *n)
 {
-	ref_t a, ae, b, be, result;
-	a = car(args);
-	ae = eval(a, assoc);
-	release_ref(&a);
-	b = cadr(args);
-	be = eval(b, assoc);
-	release_ref(&b);
+	return n->is_real ? make_real(n->r) : make_integer(n->i);
+}
 
-	if (ae.type != be.type)
-		result = nil();
-	else
+/* acc = acc op x, for op one of + - * /.  returns 0 on integer division by zero */
+static int _number_op(number_t *acc, const number_t *x, char op)
+{
+	double a, b;
+
+	if (!acc->is_real && !x->is_real)
 	{
-		if (ae.type == integer_type)
-			result = make_integer(ae.data.integer - be.data.integer);
-		else if (ae.type == real_type)
-			result = make_real(ae.data.real - be.data.real);
-		else
-			result = nil();
+		int64_t i = acc->i, j = x->i;
+
+		switch (op)
+		{
+		case '+':
+			if (j > 0 ? i <= INT64_MAX - j : i >= INT64_MIN - j)
+			{
+				acc->i = i + j;
+				return 1;
+			}
+			break;
+		case '-':
+			if (j < 0 ? i <= INT64_MAX + j : i >= INT64_MIN + j)
+			{
+				acc->i = i - j;
+				return 1;
+			}
+			break;
+		case '*':
+			if (i == 0 || j == 0)
+			{
+				acc->i = 0;
+				return 1;
+			}
+			if (!(i == -1 && j == INT64_MIN) && !(j == -1 && i == INT64_MIN) &&
+				(i > 0 ? (j > 0 ? i <= INT64_MAX / j : j >= INT64_MIN / i)
+				       : (j > 0 ? i >= INT64_MIN / j : i >= INT64_MAX / j)))
+			{
+				acc->i = i * j;
+				return 1;
+			}
+			break;
+		case '/':
+			if (j == 0)
+				return 0;
+			if (!(i == INT64_MIN && j == -1))
+			{
+				acc->i = i / j;
+				return 1;
+			}
+			break;
+		}
 	}
 
-	release_ref(&ae);
-	release_ref(&be);
-	return result;
+	/* it doesn't fit in an integer (or one of them is real to begin with) */
+	a = _as_real(acc);
+	b = _as_real(x);
+	acc->is_real = 1;
+	switch (op)
+	{
+	case '+': acc->r = a + b; break;
+	case '-': acc->r = a - b; break;
+	case '*': acc->r = a * b; break;
+	case '/': acc->r = a / b; break;
+	}
+	return 1;
 }
 
-ref_t slfe_mul(ref_t args, ref_t assoc)
+/* folds op over the arguments from left to right, in a single pass.  with one argument,
+   the result is (op identity arg), and with none it's the identity.  returns nil if any
+   argument isn't a number */
+static ref_t _arith(const ref_t *argv, size_t argc, char op, int64_t identity)
 {
-	ref_t a, ae, b, be, result;
-	a = car(args);
-	ae = eval(a, assoc);
-	release_ref(&a);
-	b = cadr(args);
-	be = eval(b, assoc);
-	release_ref(&b);
+	number_t acc, x;
+	size_t n = 0;
 
-	if (ae.type != be.type)
-		result = nil();
-	else
+	if (argc < 2)
 	{
-		if (ae.type == integer_type)
-			result = make_integer(ae.data.integer * be.data.integer);
-		else if (ae.type == real_type)
-			result = make_real(ae.data.real * be.data.real);
-		else
-			result = nil();
+		/* the reciprocal of an integer is worked out in reals, since integer division
+		   would truncate it to 0 */
+		acc.is_real = argc == 1 && op == '/';
+		acc.i = identity;
+		acc.r = (double)identity;
+	}
+	else if (!_get_number(argv[n++], &acc))
+		return nil();
+
+	for (; n < argc; ++n)
+	{
+		if (!_get_number(argv[n], &x))
+			return nil();
+		if (!_number_op(&acc, &x, op))
+		{
+			LOG_WARNING("integer division by zero");
+			return nil();
+		}
 	}
 
-	release_ref(&ae);
-	release_ref(&be);
-	return result;
+	return _make_number(&acc);
 }
 
-ref_t slfe_div(ref_t args, ref_t assoc)
+ref_t slfe_add(const ref_t *argv, size_t argc, ref_t env)
 {
-	ref_t a, ae, b, be, result;
-	a = car(args);
-	ae = eval(a, assoc);
-	release_ref(&a);
-	b = cadr(args);
-	be = eval(b, assoc);
-	release_ref(&b);
+	return _arith(argv, argc, '+', 0);
+}
 
-	if (ae.type != be.type)
-		result = nil();
+ref_t slfe_sub(const ref_t *argv, size_t argc, ref_t env)
+{
+	return _arith(argv, argc, '-', 0);
+}
+
+ref_t slfe_mul(const ref_t *argv, size_t argc, ref_t env)
+{
+	return _arith(argv, argc, '*', 1);
+}
+
+ref_t slfe_div(const ref_t *argv, size_t argc, ref_t env)
+{
+	return _arith(argv, argc, '/', 1);
+}
+
+ref_t slfe_mod(const ref_t *argv, size_t argc, ref_t env)
+{
+	ref_t a = VARG(0), b = VARG(1);
+
+	if ((a.type != b.type) || a.type != integer_type)
+		return nil();
+	else if (b.data.integer == 0)
+	{
+		LOG_WARNING("integer division by zero");
+		return nil();
+	}
+	else if (b.data.integer == -1) /* INT64_MIN % -1 traps */
+		return make_integer(0);
+	else
+		return make_integer(a.data.integer % b.data.integer);
+}
+
+static int _number_is_nan(const number_t *n)
+{
+	return n->is_real && n->r != n->r;
+}
+
+/* returns <0, 0 or >0 as a is less than, equal to or greater than b.  an integer and a
+   real are compared exactly; neither may be a NaN */
+static int _number_cmp(const number_t *a, const number_t *b)
+{
+	if (!a->is_real && !b->is_real)
+		return (a->i > b->i) - (a->i < b->i);
+	else if (!a->is_real)
+		return compare_integer_real(a->i, b->r);
+	else if (!b->is_real)
+		return -compare_integer_real(b->i, a->r);
 	else
+		return (a->r > b->r) - (a->r < b->r);
+}
+
+/* checks that test holds for each pair of neighbouring arguments, in a single pass;
+   returns t if it does, or nil if it doesn't or any argument isn't a number.  a NaN
+   is unordered, so every comparison with one fails */
+static ref_t _compare(const ref_t *argv, size_t argc, int (*test)(int cmp))
+{
+	number_t a, b;
+	size_t n;
+
+	if (argc == 0 || !_get_number(argv[0], &a) || _number_is_nan(&a))
+		return nil();
+
+	for (n = 1; n < argc; ++n)
 	{
-		if (ae.type == integer_type)
-			result = make_integer(ae.data.integer / be.data.integer);
-		else if (ae.type == real_type)
-			result = make_real(ae.data.real / be.data.real);
-		else
-			result = nil();
+		if (!_get_number(argv[n], &b) || _number_is_nan(&b) || !test(_number_cmp(&a, &b)))
+			return nil();
+		a = b;
 	}
 
-	release_ref(&ae);
-	release_ref(&be);
-	return result;
+	return make_symbol("t", 0);
+}
+
+static int _test_lt(int cmp) { return cmp < 0; }
+static int _test_le(int cmp) { return cmp <= 0; }
+static int _test_gt(int cmp) { return cmp > 0; }
+static int _test_ge(int cmp) { return cmp >= 0; }
+static int _test_eq(int cmp) { return cmp == 0; }
+
+ref_t slfe_lt(const ref_t *argv, size_t argc, ref_t env)
+{
+	return _compare(argv, argc, _test_lt);
 }
 
-ref_t slfe_mod(ref_t args, ref_t assoc)
+ref_t slfe_le(const ref_t *argv, size_t argc, ref_t env)
 {
-	ref_t a, ae, b, be, result;
-	a = car(args);
-	ae = eval(a, assoc);
-	release_ref(&a);
-	b = cadr(args);
-	be = eval(b, assoc);
-	release_ref(&b);
+	return _compare(argv, argc, _test_le);
+}
 
-	if ((ae.type != be.type) || ae.type != integer_type)
-		result = nil();
-	else
-		result = make_integer(ae.data.integer % be.data.integer);
+ref_t slfe_gt(const ref_t *argv, size_t argc, ref_t env)
+{
+	return _compare(argv, argc, _test_gt);
+}
 
-	release_ref(&ae);
-	release_ref(&be);
-	return result;
+ref_t slfe_ge(const ref_t *argv, size_t argc, ref_t env)
+{
+	return _compare(argv, argc, _test_ge);
 }
 
-ref_t slfe_bitand(ref_t args, ref_t assoc)
+ref_t slfe_num_eq(const ref_t *argv, size_t argc, ref_t env)
 {
-	ref_t a, ae, b, be, result;
-	a = car(args);
-	ae = eval(a, assoc);
-	release_ref(&a);
-	b = cadr(args);
-	be = eval(b, assoc);
-	release_ref(&b);
+	return _compare(argv, argc, _test_eq);
+}
 
-	if ((ae.type != be.type) || ae.type != integer_type)
-		result = nil();
-	else
-		result = make_integer(ae.data.integer & be.data.integer);
+/* returns whichever argument sign * cmp picks out, unchanged; nil if any argument isn't a number.
+   NaNs propagate: the first one wins */
+static ref_t _extreme(const ref_t *argv, size_t argc, int sign)
+{
+	number_t best, x;
+	size_t n, best_n = 0;
 
-	release_ref(&ae);
-	release_ref(&be);
-	return result;
+	if (argc == 0 || !_get_number(argv[0], &best))
+		return nil();
+
+	for (n = 1; n < argc; ++n)
+	{
+		if (!_get_number(argv[n], &x))
+			return nil();
+		if (_number_is_nan(&best))
+			continue;
+		if (_number_is_nan(&x) || sign * _number_cmp(&x, &best) > 0)
+		{
+			best = x;
+			best_n = n;
+		}
+	}
+
+	return clone_ref(argv[best_n]);
 }
 
-ref_t slfe_bitor(ref_t args, ref_t assoc)
+ref_t slfe_min(const ref_t *argv, size_t argc, ref_t env)
 {
-	ref_t a, ae, b, be, result;
-	a = car(args);
-	ae = eval(a, assoc);
-	release_ref(&a);
-	b = cadr(args);
-	be = eval(b, assoc);
-	release_ref(&b);
+	return _extreme(argv, argc, -1);
+}
 
-	if ((ae.type != be.type) || ae.type != integer_type)
-		result = nil();
-	else
-		result = make_integer(ae.data.integer | be.data.integer);
+ref_t slfe_max(const ref_t *argv, size_t argc, ref_t env)
+{
+	return _extreme(argv, argc, 1);
+}
 
-	release_ref(&ae);
-	release_ref(&be);
-	return result;
+ref_t slfe_abs(const ref_t *argv, size_t argc, ref_t env)
+{
+	number_t n;
+
+	if (!_get_number(VARG(0), &n))
+		return nil();
+
+	if (n.is_real)
+		return make_real(fabs(n.r));
+	else if (n.i == INT64_MIN)
+		return make_real(-(double)n.i);
+	else
+		return make_integer(n.i < 0 ? -n.i : n.i);
 }
 
-ref_t slfe_bitxor(ref_t args, ref_t assoc)
+ref_t slfe_bitand(const ref_t *argv, size_t argc, ref_t env)
 {
-	ref_t a, ae, b, be, result;
-	a = car(args);
-	ae = eval(a, assoc);
-	release_ref(&a);
-	b = cadr(args);
-	be = eval(b, assoc);
-	release_ref(&b);
+	ref_t a = VARG(0), b = VARG(1);
 
-	if ((ae.type != be.type) || ae.type != integer_type)
-		result = nil();
+	if ((a.type != b.type) || a.type != integer_type)
+		return nil();
 	else
-		result = make_integer(ae.data.integer ^ be.data.integer);
+		return make_integer(a.data.integer & b.data.integer);
+}
 
-	release_ref(&ae);
-	release_ref(&be);
-	return result;
+ref_t slfe_bitor(const ref_t *argv, size_t argc, ref_t env)
+{
+	ref_t a = VARG(0), b = VARG(1);
+
+	if ((a.type != b.type) || a.type != integer_type)
+		return nil();
+	else
+		return make_integer(a.data.integer | b.data.integer);
 }
 
-ref_t slfe_bitnot(ref_t args, ref_t assoc)
+ref_t slfe_bitxor(const ref_t *argv, size_t argc, ref_t env)
 {
-	ref_t a, ae, result;
-	a = car(args);
-	ae = eval(a, assoc);
-	release_ref(&a);
+	ref_t a = VARG(0), b = VARG(1);
 
-	if (ae.type != integer_type)
-		result = nil();
+	if ((a.type != b.type) || a.type != integer_type)
+		return nil();
 	else
-		result = make_integer(~ ae.data.integer);
+		return make_integer(a.data.integer ^ b.data.integer);
+}
 
-	release_ref(&ae);
-	return result;
+ref_t slfe_bitnot(const ref_t *argv, size_t argc, ref_t env)
+{
+	ref_t a = VARG(0);
+
+	if (a.type != integer_type)
+		return nil();
+	else
+		return make_integer(~ a.data.integer);
 }
 
 ref_t slfe_gc_collect(ref_t args, ref_t assoc)
 {
-	collect_garbage();
+	/* values that are only referenced from the C stack aren't roots,
+	   so it isn't safe to collect in the middle of an evaluation */
+	request_garbage_collection();
 	return nil();
 }
 
@@ -730,16 +2717,115 @@ ref_t slfe_quasiquote(ref_t args, ref_t assoc)
 void register_core_lib(ref_t env)
 {
 	REG_FN(quote, env);
-	REG_FN(eq, env);
-	REG_FN(eql, env);
+	REG_VFN(eq, env);
+	REG_VFN(eql, env);
 	REG_FN(cond, env);
+	REG_FN(if, env);
+	REG_FN(when, env);
+	REG_FN(unless, env);
+	REG_FN(and, env);
+	REG_FN(or, env);
+	REG_FN(while, env);
+	REG_NAMED_FN("let*", slfe_let_star, env);
+	REG_FN(case, env);
+	REG_FN(defstruct, env);
 	REG_FN(do, env);
 	REG_FN(scope, env);
 	REG_FN(apply, env);
-	REG_FN(car, env);
-	REG_FN(cdr, env);
-	REG_FN(cons, env);
-	REG_FN(atom, env);
+	REG_VFN(car, env);
+	REG_VFN(cdr, env);
+	REG_VFN(cons, env);
+	REG_VFN(atom, env);
+
+	REG_VFN(length, env);
+	REG_VFN(append, env);
+	REG_VFN(reverse, env);
+	REG_VFN(nth, env);
+	REG_VFN(assoc, env);
+	REG_VFN(member, env);
+	REG_VFN(mapcar, env);
+	REG_VFN(filter, env);
+	REG_VFN(foldl, env);
+
+	REG_VFN(vector, env);
+	REG_NAMED_VFN("make-vector", slfe_make_vector, env);
+	REG_NAMED_VFN("vector-ref", slfe_vector_ref, env);
+	REG_NAMED_VFN("vector-set!", slfe_vector_set, env);
+	REG_NAMED_VFN("vector-length", slfe_vector_length, env);
+	REG_NAMED_VFN("vector->list", slfe_vector_to_list, env);
+	REG_NAMED_VFN("list->vector", slfe_list_to_vector, env);
+
+	REG_VFN(f64vector, env);
+	REG_VFN(i64vector, env);
+	REG_NAMED_VFN("make-f64vector", slfe_make_f64vector, env);
+	REG_NAMED_VFN("make-i64vector", slfe_make_i64vector, env);
+	REG_NAMED_VFN("list->f64vector", slfe_list_to_f64vector, env);
+	REG_NAMED_VFN("list->i64vector", slfe_list_to_i64vector, env);
+	REG_VFN(vsum, env);
+	REG_VFN(vdot, env);
+	REG_VFN(vscale, env);
+	REG_VFN(vaxpy, env);
+	REG_VFN(vadd, env);
+	REG_VFN(vmul, env);
+	REG_VFN(vmin, env);
+	REG_VFN(vmax, env);
+	REG_NAMED_VFN("vprefix-sum", slfe_vprefix_sum, env);
+
+	REG_NAMED_VFN("make-hash-table", slfe_make_hash_table, env);
+	REG_NAMED_VFN("hash-get", slfe_hash_get, env);
+	REG_NAMED_VFN("hash-set!", slfe_hash_set, env);
+	REG_NAMED_VFN("hash-remove!", slfe_hash_remove, env);
+	REG_NAMED_VFN("hash-count", slfe_hash_count, env);
+	REG_NAMED_VFN("hash-keys", slfe_hash_keys, env);
+	REG_NAMED_VFN("hash-values", slfe_hash_values, env);
+	REG_NAMED_VFN("hash->list", slfe_hash_to_list, env);
+	REG_NAMED_VFN("hash-for-each", slfe_hash_for_each, env);
+
+	REG_NAMED_VFN("make-sorted-map", slfe_make_sorted_map, env);
+	REG_NAMED_VFN("sorted-map-put", slfe_sorted_map_put, env);
+	REG_NAMED_VFN("sorted-map-get", slfe_sorted_map_get, env);
+	REG_NAMED_VFN("sorted-map-delete", slfe_sorted_map_delete, env);
+	REG_NAMED_VFN("sorted-map-count", slfe_sorted_map_count, env);
+	REG_NAMED_VFN("sorted-map-floor", slfe_sorted_map_floor, env);
+	REG_NAMED_VFN("sorted-map-ceiling", slfe_sorted_map_ceiling, env);
+	REG_NAMED_VFN("sorted-map-range", slfe_sorted_map_range, env);
+	REG_NAMED_VFN("sorted-map-for-each", slfe_sorted_map_for_each, env);
+
+	REG_VFN(pvec, env);
+	REG_NAMED_VFN("list->pvec", slfe_list_to_pvec, env);
+	REG_NAMED_VFN("pvec->list", slfe_pvec_to_list, env);
+	REG_NAMED_VFN("pvec-length", slfe_pvec_length, env);
+	REG_NAMED_VFN("pvec-ref", slfe_pvec_ref, env);
+	REG_NAMED_VFN("pvec-set", slfe_pvec_set, env);
+	REG_NAMED_VFN("pvec-push", slfe_pvec_push, env);
+	REG_NAMED_VFN("pvec-pop", slfe_pvec_pop, env);
+	REG_NAMED_VFN("pvec-set!", slfe_pvec_set_in_place, env);
+	REG_NAMED_VFN("pvec-push!", slfe_pvec_push_in_place, env);
+	REG_NAMED_VFN("pvec-pop!", slfe_pvec_pop_in_place, env);
+
+	REG_VFN(pmap, env);
+	REG_NAMED_VFN("alist->pmap", slfe_alist_to_pmap, env);
+	REG_NAMED_VFN("pmap-get", slfe_pmap_get, env);
+	REG_NAMED_VFN("pmap-count", slfe_pmap_count, env);
+	REG_NAMED_VFN("pmap-set", slfe_pmap_set, env);
+	REG_NAMED_VFN("pmap-remove", slfe_pmap_remove, env);
+	REG_NAMED_VFN("pmap-set!", slfe_pmap_set_in_place, env);
+	REG_NAMED_VFN("pmap-remove!", slfe_pmap_remove_in_place, env);
+	REG_NAMED_VFN("pmap-keys", slfe_pmap_keys, env);
+	REG_NAMED_VFN("pmap-values", slfe_pmap_values, env);
+	REG_NAMED_VFN("pmap->list", slfe_pmap_to_list, env);
+	REG_NAMED_VFN("pmap-for-each", slfe_pmap_for_each, env);
+
+	REG_VFN(transient, env);
+	REG_NAMED_VFN("persistent!", slfe_persistent, env);
+
+	REG_VFN(caar, env); REG_VFN(cadr, env); REG_VFN(cdar, env); REG_VFN(cddr, env);
+	REG_VFN(caaar, env); REG_VFN(caadr, env); REG_VFN(cadar, env); REG_VFN(caddr, env);
+	REG_VFN(cdaar, env); REG_VFN(cdadr, env); REG_VFN(cddar, env); REG_VFN(cdddr, env);
+	REG_VFN(caaaar, env); REG_VFN(caaadr, env); REG_VFN(caadar, env); REG_VFN(caaddr, env);
+	REG_VFN(cadaar, env); REG_VFN(cadadr, env); REG_VFN(caddar, env); REG_VFN(cadddr, env);
+	REG_VFN(cdaaar, env); REG_VFN(cdaadr, env); REG_VFN(cdadar, env); REG_VFN(cdaddr, env);
+	REG_VFN(cddaar, env); REG_VFN(cddadr, env); REG_VFN(cdddar, env); REG_VFN(cddddr, env);
 	REG_FN(closure, env);
 	REG_FN(macro, env);
 	REG_FN(fn, env);
@@ -751,9 +2837,14 @@ void register_core_lib(ref_t env)
 	REG_FN(type, env);
 	REG_FN(quasiquote, env);
 	REG_NAMED_FN("macro-expand", slfe_macro_expand, env);
+	REG_NAMED_VFN("macro-expand-all", slfe_macro_expand_all, env);
+	REG_NAMED_VFN("macroexpand-all", slfe_macro_expand_all, env);
 	REG_NAMED_FN("get-env", slfe_get_env, env);
 	REG_NAMED_FN("env-set", slfe_env_set, env);
 	REG_NAMED_FN("env-let", slfe_env_let, env);
+	REG_NAMED_FN("env-set-const", slfe_env_set_const, env);
+	REG_NAMED_FN("env-is-const", slfe_env_is_const, env);
+	REG_NAMED_FN("env-get-const", slfe_env_is_const, env);
 	REG_NAMED_FN("gc-collect", slfe_gc_collect, env);
 
 	REG_NAMED_FN("closure-code", slfe_closure_code, env);
@@ -761,14 +2852,22 @@ void register_core_lib(ref_t env)
 	REG_NAMED_FN("closure-env", slfe_closure_env, env);
 	REG_NAMED_FN("make-closure", slfe_make_closure, env);
 
-	REG_NAMED_FN("+", slfe_add, env);
-	REG_NAMED_FN("-", slfe_sub, env);
-	REG_NAMED_FN("*", slfe_mul, env);
-	REG_NAMED_FN("/", slfe_div, env);
-	REG_NAMED_FN("%", slfe_mod, env);
+	REG_NAMED_VFN("+", slfe_add, env);
+	REG_NAMED_VFN("-", slfe_sub, env);
+	REG_NAMED_VFN("*", slfe_mul, env);
+	REG_NAMED_VFN("/", slfe_div, env);
+	REG_NAMED_VFN("%", slfe_mod, env);
+	REG_NAMED_VFN("<", slfe_lt, env);
+	REG_NAMED_VFN("<=", slfe_le, env);
+	REG_NAMED_VFN(">", slfe_gt, env);
+	REG_NAMED_VFN(">=", slfe_ge, env);
+	REG_NAMED_VFN("=", slfe_num_eq, env);
+	REG_VFN(min, env);
+	REG_VFN(max, env);
+	REG_VFN(abs, env);
 	
-	REG_NAMED_FN("&", slfe_bitand, env);
-	REG_NAMED_FN("|", slfe_bitor, env);
-	REG_NAMED_FN("^", slfe_bitxor, env);
-	REG_NAMED_FN("~", slfe_bitnot, env);
+	REG_NAMED_VFN("&", slfe_bitand, env);
+	REG_NAMED_VFN("|", slfe_bitor, env);
+	REG_NAMED_VFN("^", slfe_bitxor, env);
+	REG_NAMED_VFN("~", slfe_bitnot, env);
 }
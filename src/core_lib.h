@@ -14,13 +14,121 @@
 	  stack_let(e, name, val); \
 	  release_ref(&name); release_ref(&val); }
 
+/* for functions that take evaluated arguments (see foreign_vexec_t) */
+#define REG_VFN(n, e) \
+	{ ref_t name = make_symbol(#n, 0); \
+	  ref_t val = make_foreign_vexec(slfe_##n); \
+	  stack_let(e, name, val); \
+	  release_ref(&name); release_ref(&val); }
+
+#define REG_NAMED_VFN(n, f, e) \
+	{ ref_t name = make_symbol(n, 0); \
+	  ref_t val = make_foreign_vexec(f); \
+	  stack_let(e, name, val); \
+	  release_ref(&name); release_ref(&val); }
+
 ref_t slfe_quote(ref_t args, ref_t assoc);
-ref_t slfe_eq(ref_t args, ref_t assoc);
-ref_t slfe_eql(ref_t args, ref_t assoc);
+ref_t slfe_eq(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_eql(const ref_t *argv, size_t argc, ref_t env);
 ref_t slfe_cond(ref_t args, ref_t assoc);
-ref_t slfe_car(ref_t args, ref_t assoc);
-ref_t slfe_cdr(ref_t args, ref_t assoc);
-ref_t slfe_atom(ref_t args, ref_t assoc);
+ref_t slfe_if(ref_t args, ref_t assoc);
+ref_t slfe_when(ref_t args, ref_t assoc);
+ref_t slfe_unless(ref_t args, ref_t assoc);
+ref_t slfe_and(ref_t args, ref_t assoc);
+ref_t slfe_or(ref_t args, ref_t assoc);
+ref_t slfe_while(ref_t args, ref_t assoc);
+ref_t slfe_let_star(ref_t args, ref_t assoc);
+ref_t slfe_defstruct(ref_t args, ref_t assoc);
+ref_t slfe_case(ref_t args, ref_t assoc);
+
+/* the forms above that end with a form in tail position, as tail_form_t's */
+int slfe_cond_tail(ref_t args, ref_t assoc, ref_t *tail, ref_t *result);
+int slfe_if_tail(ref_t args, ref_t assoc, ref_t *tail, ref_t *result);
+int slfe_when_tail(ref_t args, ref_t assoc, ref_t *tail, ref_t *result);
+int slfe_unless_tail(ref_t args, ref_t assoc, ref_t *tail, ref_t *result);
+int slfe_and_tail(ref_t args, ref_t assoc, ref_t *tail, ref_t *result);
+int slfe_or_tail(ref_t args, ref_t assoc, ref_t *tail, ref_t *result);
+int slfe_case_tail(ref_t args, ref_t assoc, ref_t *tail, ref_t *result);
+
+/* returns 1 if a case clause's keys are t or otherwise, which match anything */
+int case_is_default(ref_t keys);
+ref_t slfe_car(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_cdr(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_atom(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_length(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_append(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_reverse(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_nth(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_assoc(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_member(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_mapcar(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_filter(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_foldl(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_make_vector(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_vector(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_vector_ref(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_vector_set(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_vector_length(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_vector_to_list(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_list_to_vector(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_make_f64vector(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_make_i64vector(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_f64vector(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_i64vector(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_list_to_f64vector(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_list_to_i64vector(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_vsum(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_vdot(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_vscale(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_vaxpy(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_vadd(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_vmul(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_vmin(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_vmax(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_vprefix_sum(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_make_hash_table(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_hash_get(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_hash_set(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_hash_remove(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_hash_count(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_hash_keys(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_hash_values(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_hash_to_list(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_hash_for_each(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_make_sorted_map(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_sorted_map_put(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_sorted_map_get(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_sorted_map_delete(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_sorted_map_count(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_sorted_map_floor(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_sorted_map_ceiling(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_sorted_map_range(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_sorted_map_for_each(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_pvec(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_list_to_pvec(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_pvec_to_list(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_pvec_length(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_pvec_ref(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_pvec_set(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_pvec_push(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_pvec_pop(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_pvec_set_in_place(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_pvec_push_in_place(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_pvec_pop_in_place(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_pmap(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_alist_to_pmap(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_pmap_get(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_pmap_count(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_pmap_set(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_pmap_remove(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_pmap_set_in_place(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_pmap_remove_in_place(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_pmap_keys(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_pmap_values(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_pmap_to_list(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_pmap_for_each(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_transient(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_persistent(const ref_t *argv, size_t argc, ref_t env);
 ref_t slfe_macro(ref_t args, ref_t assoc);
 ref_t slfe_fn(ref_t args, ref_t assoc);
 ref_t slfe_closure(ref_t args, ref_t assoc);
@@ -28,11 +136,14 @@ ref_t slfe_set(ref_t args, ref_t assoc);
 ref_t slfe_env_set(ref_t args, ref_t assoc);
 ref_t slfe_let(ref_t args, ref_t assoc);
 ref_t slfe_env_let(ref_t args, ref_t assoc);
-ref_t slfe_cons(ref_t args, ref_t assoc);
+ref_t slfe_env_set_const(ref_t args, ref_t assoc);
+ref_t slfe_env_is_const(ref_t args, ref_t assoc);
+ref_t slfe_cons(const ref_t *argv, size_t argc, ref_t env);
 ref_t slfe_do(ref_t args, ref_t assoc);
 ref_t slfe_scope(ref_t args, ref_t assoc);
 ref_t slfe_apply(ref_t args, ref_t assoc);
 ref_t slfe_macro_expand(ref_t args, ref_t assoc);
+ref_t slfe_macro_expand_all(const ref_t *argv, size_t argc, ref_t env);
 ref_t slfe_closure_code(ref_t args, ref_t assoc);
 ref_t slfe_closure_env(ref_t args, ref_t assoc);
 ref_t slfe_closure_plist(ref_t args, ref_t assoc);
@@ -42,15 +153,23 @@ ref_t slfe_read(ref_t args, ref_t assoc);
 ref_t slfe_eval(ref_t args, ref_t assoc);
 ref_t slfe_get_env(ref_t args, ref_t assoc);
 ref_t slfe_type(ref_t args, ref_t assoc);
-ref_t slfe_add(ref_t args, ref_t assoc);
-ref_t slfe_sub(ref_t args, ref_t assoc);
-ref_t slfe_mul(ref_t args, ref_t assoc);
-ref_t slfe_div(ref_t args, ref_t assoc);
-ref_t slfe_mod(ref_t args, ref_t assoc);
-ref_t slfe_bitand(ref_t args, ref_t assoc);
-ref_t slfe_bitor(ref_t args, ref_t assoc);
-ref_t slfe_bitxor(ref_t args, ref_t assoc);
-ref_t slfe_bitnot(ref_t args, ref_t assoc);
+ref_t slfe_add(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_sub(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_mul(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_div(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_mod(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_lt(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_le(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_gt(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_ge(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_num_eq(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_min(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_max(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_abs(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_bitand(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_bitor(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_bitxor(const ref_t *argv, size_t argc, ref_t env);
+ref_t slfe_bitnot(const ref_t *argv, size_t argc, ref_t env);
 ref_t slfe_gc_collect(ref_t args, ref_t assoc);
 
 #endif
@@ -20,6 +20,64 @@ int eql(ref_t a, ref_t b)
 	return a.type->eql(a, b);
 }
 
+/* hash_eql only goes this many containers deep; deeper ones hash by type alone */
+#define HASH_MAX_DEPTH (3)
+static int hash_depth = 0;
+
+size_t hash_mix(uint64_t x)
+{
+	/* the murmur3 finalizer */
+	x ^= x >> 33;
+	x *= UINT64_C(0xff51afd7ed558ccd);
+	x ^= x >> 33;
+	x *= UINT64_C(0xc4ceb9fe1a85ec53);
+	x ^= x >> 33;
+	return (size_t)x;
+}
+
+size_t hash_combine(size_t seed, size_t h)
+{
+	return hash_mix((uint64_t)seed * 31 + h);
+}
+
+size_t hash_eq(ref_t a)
+{
+	double d;
+	uint64_t bits;
+
+	if (a.type == NIL)
+		return 0;
+	else if (a.type == integer_type)
+		return hash_mix((uint64_t)a.data.integer);
+	else if (a.type == real_type)
+	{
+		/* 0.0 and -0.0 are eq, so they need the same hash */
+		d = a.data.real == 0.0 ? 0.0 : a.data.real;
+		memcpy(&bits, &d, sizeof(bits));
+		return hash_mix(bits);
+	}
+
+	/* everything else is eq by identity */
+	return hash_mix((uint64_t)(uintptr_t)a.data.object);
+}
+
+size_t hash_eql(ref_t a)
+{
+	size_t h;
+
+	if (a.type == NIL)
+		return 0;
+
+	if (!a.type->hash || hash_depth >= HASH_MAX_DEPTH)
+		return hash_mix((uint64_t)(uintptr_t)a.type);
+
+	++hash_depth;
+	h = a.type->hash(a);
+	--hash_depth;
+
+	return h;
+}
+
 int eq(ref_t a, ref_t b)
 {
 	if (a.type != b.type)
@@ -126,9 +184,39 @@ ref_t list_from_array(ref_t *refs, size_t num)
 	return cons;
 }
 
-void map_let(ref_t frame, ref_t names, ref_t vals)
+static ref_t optional_keyword = {0};
+static ref_t rest_keyword = {0};
+
+static void _init_keywords()
+{
+	if (optional_keyword.type)
+		return;
+
+	/* these are never released, so they stay interned */
+	optional_keyword = make_symbol("&optional", 0);
+	rest_keyword = make_symbol("&rest", 0);
+}
+
+ref_t param_name(ref_t p)
+{
+	_init_keywords();
+
+	if (p.type == symbol_type &&
+		(p.data.symb == optional_keyword.data.symb || p.data.symb == rest_keyword.data.symb))
+	{
+		return nil();
+	}
+
+	if (p.type == cons_type)
+		return ((cons_t*)p.data.object)->car;
+
+	return p;
+}
+
+static void _bind_params(ref_t frame, ref_t names, ref_t vals, ref_t assoc, int evaluate)
 {
-	ref_t nar, var, ndr, vdr;
+	ref_t p, name, val, default_val;
+	int optional = 0, rest = 0;
 
 	if (frame.type != stack_type)
 	{
@@ -136,20 +224,71 @@ void map_let(ref_t frame, ref_t names, ref_t vals)
 		return;
 	}
 
-	if (names.type == NIL)
-		return;
+	_init_keywords();
 
-	nar = car(names);
-	var = car(vals);
-	stack_let(frame, nar, var);
-	release_ref(&nar);
-	release_ref(&var);
+	/* the lists are only read, so they can be walked without taking references */
+	for (; names.type == cons_type; names = ((cons_t*)names.data.object)->cdr)
+	{
+		p = ((cons_t*)names.data.object)->car;
+
+		if (p.type == symbol_type && p.data.symb == optional_keyword.data.symb)
+		{
+			optional = 1;
+			continue;
+		}
+		else if (p.type == symbol_type && p.data.symb == rest_keyword.data.symb)
+		{
+			rest = 1;
+			continue;
+		}
+
+		name = p;
+		default_val = nil();
+		if (optional && p.type == cons_type)
+		{
+			name = ((cons_t*)p.data.object)->car;
+			if (((cons_t*)p.data.object)->cdr.type == cons_type)
+				default_val = ((cons_t*)((cons_t*)p.data.object)->cdr.data.object)->car;
+		}
+
+		if (rest)
+		{
+			val = evaluate ? map_eval(vals, assoc) : clone_ref(vals);
+			vals = nil();
+		}
+		else if (vals.type == cons_type)
+		{
+			val = ((cons_t*)vals.data.object)->car;
+			val = evaluate ? eval(val, assoc) : clone_ref(val);
+			vals = ((cons_t*)vals.data.object)->cdr;
+		}
+		else if (default_val.type)
+			val = eval(default_val, frame); /* so it can refer to the parameters before it */
+		else
+			val = nil();
+
+		stack_let(frame, name, val);
+		release_ref(&val);
+	}
 
-	ndr = cdr(names);
-	vdr = cdr(vals);
-	map_let(frame, ndr, vdr);
-	release_ref(&ndr);
-	release_ref(&vdr);
+	if (evaluate)
+	{
+		for (; vals.type == cons_type; vals = ((cons_t*)vals.data.object)->cdr)
+		{
+			val = eval(((cons_t*)vals.data.object)->car, assoc);
+			release_ref(&val);
+		}
+	}
+}
+
+void map_let(ref_t frame, ref_t names, ref_t vals)
+{
+	_bind_params(frame, names, vals, nil(), 0);
+}
+
+void map_let_eval(ref_t frame, ref_t names, ref_t vals, ref_t assoc)
+{
+	_bind_params(frame, names, vals, assoc, 1);
 }
 
 ref_t call(ref_t exec, ref_t args, ref_t assoc)
@@ -193,6 +332,42 @@ ref_t map_eval(ref_t l, ref_t assoc)
 	return cons;
 }
 
+ref_t eval_body(ref_t body, ref_t assoc)
+{
+	ref_t result = nil();
+	cons_t *cons;
+
+	for (; body.type == cons_type; body = cons->cdr)
+	{
+		cons = (cons_t*)body.data.object;
+		release_ref(&result);
+		result = eval(cons->car, assoc);
+	}
+
+	return result;
+}
+
+int eval_body_tail(ref_t body, ref_t assoc, ref_t *tail, ref_t *result)
+{
+	ref_t val;
+	cons_t *cons;
+
+	if (body.type != cons_type)
+	{
+		*result = nil();
+		return 0;
+	}
+
+	for (cons = (cons_t*)body.data.object; cons->cdr.type == cons_type; cons = (cons_t*)cons->cdr.data.object)
+	{
+		val = eval(cons->car, assoc);
+		release_ref(&val);
+	}
+
+	*tail = cons->car;
+	return 1;
+}
+
 ref_t eval(ref_t e, ref_t a)
 {
 	ref_t result;
@@ -14,6 +14,15 @@ static int in_sweep_cycle = 0;
 static size_t num_roots = 0;
 static gc_object_t **gc_roots = 0;
 
+/* most garbage is freed as soon as its ref count drops to zero, so a full cycle is only
+   needed to clean up cycles; collect_garbage_if_needed waits until the number of objects
+   has doubled since the last cycle, so that collecting doesn't cost time proportional to
+   the whole heap every time it's called */
+#define GC_MIN_COLLECT_OBJECTS (4096)
+static size_t num_objects = 0;
+static size_t next_collect_objects = GC_MIN_COLLECT_OBJECTS;
+static int collect_requested = 0;
+
 static void _gc_free(gc_object_t *o);
 static void _gc_unregister_object(gc_object_t *o);
 static void _gc_clear_marks();
@@ -112,16 +121,34 @@ void unregister_gc_root(ref_t ref)
 
 void gc_init_object(gc_object_t *o, const type_traits_t *type)
 {
-	assert(o);
+	gc_init_local_object(o, type);
+	gc_register_object(o);
+}
 
-	o->next_gc_object = first_gc_object;
-	first_gc_object = o;
+void gc_init_local_object(gc_object_t *o, const type_traits_t *type)
+{
+	assert(o);
 
+	o->next_gc_object = 0;
+	o->prev_gc_object = 0;
 	o->marked = 0; /* TODO: work out what marked should actually be... */
 	o->rc = 1;
+	o->flags = 0;
 	o->type = type;
 }
 
+void gc_register_object(gc_object_t *o)
+{
+	assert(o && !o->next_gc_object && !o->prev_gc_object && o != first_gc_object);
+
+	o->next_gc_object = first_gc_object;
+	o->prev_gc_object = 0;
+	if (first_gc_object)
+		first_gc_object->prev_gc_object = o;
+	first_gc_object = o;
+	++num_objects;
+}
+
 void gc_traits_addref(ref_t instance)
 {
 	gc_add_ref(instance.data.object);
@@ -172,6 +199,7 @@ void gc_release_ref(gc_object_t *o)
 	if (! --o->rc)
 	{
 		_gc_unregister_object(o);
+		--num_objects;
 		_gc_free(o);
 	}
 }
@@ -241,6 +269,9 @@ static void _gc_sweep()
 		if (! o->marked)
 		{
 			*prev = next;
+			if (next)
+				next->prev_gc_object = o->prev_gc_object;
+			--num_objects;
 
 			_gc_sweep_refs(o);
 			o->next_gc_object = free_list;
@@ -273,25 +304,19 @@ static void _gc_mark_roots()
 
 static void _gc_unregister_object(gc_object_t *obj)
 {
-	if (first_gc_object == obj)
-	{
-		first_gc_object = obj->next_gc_object;
-		obj->next_gc_object = 0;
-	}
+	if (obj->prev_gc_object)
+		obj->prev_gc_object->next_gc_object = obj->next_gc_object;
 	else
 	{
-		gc_object_t *o = first_gc_object;
-		while (o)
-		{
-			if (o->next_gc_object == obj)
-			{
-				o->next_gc_object = obj->next_gc_object;
-				obj->next_gc_object = 0;
-				break;
-			}
-			o = o->next_gc_object;
-		}
+		assert(first_gc_object == obj);
+		first_gc_object = obj->next_gc_object;
 	}
+
+	if (obj->next_gc_object)
+		obj->next_gc_object->prev_gc_object = obj->prev_gc_object;
+
+	obj->next_gc_object = 0;
+	obj->prev_gc_object = 0;
 }
 
 void gc_mark(gc_object_t *o)
@@ -316,4 +341,20 @@ void collect_garbage()
 	_gc_clear_marks();
 	_gc_mark_roots();
 	_gc_sweep();
+
+	collect_requested = 0;
+	next_collect_objects = num_objects * 2;
+	if (next_collect_objects < GC_MIN_COLLECT_OBJECTS)
+		next_collect_objects = GC_MIN_COLLECT_OBJECTS;
+}
+
+void collect_garbage_if_needed()
+{
+	if (collect_requested || num_objects >= next_collect_objects)
+		collect_garbage();
+}
+
+void request_garbage_collection()
+{
+	collect_requested = 1;
 }
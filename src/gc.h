@@ -13,13 +13,28 @@ typedef unsigned long refcount_t;
 struct gc_object_ts
 {
 	struct gc_object_ts *next_gc_object;
+	struct gc_object_ts *prev_gc_object; /* so that objects can be unregistered without searching */
 	byte_t rc;
 	byte_t marked;
+	byte_t flags; /* GC_FLAG_* bits; not used by the collector itself */
 	const type_traits_t *type;
 };
 
+/* set on code trees that have already been through lexical_resolve */
+#define GC_FLAG_RESOLVED (1)
+/* set on resolved closure bodies that don't do anything which could keep hold of their frame */
+#define GC_FLAG_LEAF (2)
+/* set on a container while it's being printed, so that one which holds itself doesn't print forever */
+#define GC_FLAG_PRINTING (4)
+
 void gc_init_object(gc_object_t *o, const type_traits_t *type); /* initializes an object with a ref count of 1 */
 
+/* initializes an object without putting it on the collector's list of objects.  until it
+   is handed over with gc_register_object, its owner has to free it, and must not let its
+   ref count drop to zero through gc_release_ref */
+void gc_init_local_object(gc_object_t *o, const type_traits_t *type);
+void gc_register_object(gc_object_t *o);
+
 void gc_add_ref(gc_object_t *o);
 void gc_release_ref(gc_object_t *o);
 void gc_mark(gc_object_t *o);
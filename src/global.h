@@ -12,6 +12,7 @@
 #include <stdint.h>
 #include <inttypes.h>
 #include <assert.h>
+#include <errno.h>
 
 #include "mem.h"
 
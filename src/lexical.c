@@ -0,0 +1,1354 @@
+/* vim: set ts=4 sts=4 sw=4 noet ai: */
+#include "global.h"
+
+#include "smalisp.h"
+#include "gc.h"
+#include "cons.h"
+#include "symbol.h"
+#include "stack_frame.h"
+#include "stack.h"
+#include "lexical.h"
+#include "core_lib.h"
+
+/* how a built-in form treats its arguments, as far as the resolver is concerned */
+typedef enum form_kind_ts
+{
+	FORM_UNKNOWN = 0, /* anything might happen, including new bindings in the calling environment */
+	FORM_QUOTE,       /* nothing is evaluated */
+	FORM_CALL,        /* every argument is evaluated in the calling environment */
+	FORM_COND,        /* (cond (test expr) ...) */
+	FORM_LET,         /* (let name expr); binds name in the calling environment */
+	FORM_SET,         /* (set name expr); rebinds an existing name */
+	FORM_LAMBDA,      /* (fn param-list code); code is evaluated one frame deeper */
+	FORM_CASE         /* (case key (keys expr...) ...) */
+} form_kind_t;
+
+typedef struct form_decl_ts
+{
+	foreign_exec_t fexec;
+	form_kind_t kind;
+	tail_form_t tail; /* for forms that end with a form in tail position */
+} form_decl_t;
+
+/* forms that aren't listed here (scope, eval, env-let, get-env, quasiquote, ...)
+   are treated as unknown.  foreign vexecs don't need to be listed, since they
+   always evaluate all of their arguments */
+static const form_decl_t form_decls[] =
+{
+	{slfe_quote, FORM_QUOTE, 0},
+	{slfe_cond, FORM_COND, slfe_cond_tail},
+	{slfe_if, FORM_CALL, slfe_if_tail}, /* these evaluate some of their arguments in the calling environment, and no more */
+	{slfe_when, FORM_CALL, slfe_when_tail},
+	{slfe_unless, FORM_CALL, slfe_unless_tail},
+	{slfe_and, FORM_CALL, slfe_and_tail},
+	{slfe_or, FORM_CALL, slfe_or_tail},
+	{slfe_while, FORM_CALL, 0},
+	{slfe_case, FORM_CASE, slfe_case_tail},
+	{slfe_do, FORM_CALL, eval_body_tail},
+	{slfe_apply, FORM_CALL, 0},
+	{slfe_closure, FORM_LAMBDA, 0},
+	{slfe_macro, FORM_LAMBDA, 0},
+	{slfe_fn, FORM_LAMBDA, 0},
+	{slfe_set, FORM_SET, 0},
+	{slfe_let, FORM_LET, 0},
+	{slfe_print, FORM_CALL, 0},
+	{slfe_type, FORM_CALL, 0},
+	{slfe_env_set, FORM_CALL, 0},
+	{slfe_env_set_const, FORM_CALL, 0},
+	{slfe_env_is_const, FORM_CALL, 0},
+	{slfe_closure_code, FORM_CALL, 0},
+	{slfe_closure_plist, FORM_CALL, 0},
+	{slfe_closure_env, FORM_CALL, 0},
+	{slfe_make_closure, FORM_CALL, 0},
+	{0, FORM_UNKNOWN, 0}
+};
+
+/* one closure body; levels are chained outwards through nested closures */
+typedef struct level_ts level_t;
+struct level_ts
+{
+	level_t *outer;
+	ref_t param_list;
+	vector_t lets; /* symbol_t* bound by let forms directly in this body */
+	int dirty; /* the body contains forms that might bind arbitrary names */
+	int captures; /* the body contains forms that might keep a reference to its frame */
+	int expand; /* macro calls are expanded, rather than names being resolved */
+};
+
+int call_site_hit_count = 0;
+int call_site_miss_count = 0;
+
+static int _same_ref(ref_t a, ref_t b)
+{
+	return a.type == b.type && a.data.object == b.data.object;
+}
+
+/* the things that _rewrite builds code out of, which carry GC_FLAG_RESOLVED and GC_FLAG_LEAF */
+static int _is_code(ref_t ref)
+{
+	return ref.type == cons_type || ref.type == lambda_site_type ||
+		ref.type == macro_site_type || ref.type == call_site_type ||
+		ref.type == case_site_type;
+}
+
+static void lexical_traits_gc_mark(ref_t instance)
+{
+	lexical_t *lex = (lexical_t*)instance.data.object;
+	assert(lex);
+	ref_gc_mark(lex->symbol);
+}
+
+static void lexical_traits_gc_release_refs(ref_t instance)
+{
+	lexical_t *lex = (lexical_t*)instance.data.object;
+	assert(lex);
+	release_ref(&lex->symbol);
+}
+
+static void lexical_traits_gc_free_mem(ref_t instance)
+{
+	lexical_t *lex = (lexical_t*)instance.data.object;
+	assert(lex);
+	X_FREE(lex);
+}
+
+static void lexical_traits_print(ref_t instance, FILE *to)
+{
+	lexical_t *lex = (lexical_t*)instance.data.object;
+	assert(lex);
+	print(lex->symbol, to);
+}
+
+static int lexical_traits_eq(ref_t a, ref_t b)
+{
+	return a.data.object == b.data.object;
+}
+
+static int lexical_traits_eql(ref_t a, ref_t b)
+{
+	lexical_t *al = (lexical_t*)a.data.object;
+	lexical_t *bl = (lexical_t*)b.data.object;
+	return eq(al->symbol, bl->symbol) && al->depth == bl->depth && al->index == bl->index;
+}
+
+static ref_t lexical_traits_eval(ref_t instance, ref_t context)
+{
+	lexical_t *lex = (lexical_t*)instance.data.object;
+	stack_t *s;
+	size_t d;
+
+	assert(lex);
+
+	if (context.type == stack_type)
+	{
+		s = (stack_t*)context.data.object;
+		for (d = lex->depth; s && d; --d)
+			s = s->parent;
+
+		if (s && lex->index < s->frame->items.size)
+		{
+			stack_slot_t *slot = (stack_slot_t*)vector_nth(&s->frame->items, lex->index);
+			if (slot->symbol.data.symb == lex->symbol.data.symb)
+				return clone_ref(slot->value);
+		}
+	}
+
+	/* the environment isn't the shape the code was resolved for
+	   (eg, the code was reused by make-closure), so look the name up normally */
+	return eval(lex->symbol, context);
+}
+
+static const type_traits_t lexical_traits =
+{
+	lexical_traits_eval,
+	0, /* not executable */
+	lexical_traits_print,
+	0, /* no type name (hidden type) */
+	lexical_traits_eq,
+	lexical_traits_eql,
+	0, /* no hash (hidden type) */
+	gc_traits_addref,
+	gc_traits_release,
+	lexical_traits_gc_mark,
+	lexical_traits_gc_release_refs,
+	lexical_traits_gc_free_mem
+};
+const type_traits_t *lexical_type = &lexical_traits;
+
+static ref_t make_lexical(ref_t symbol, size_t depth, size_t index)
+{
+	ref_t ref;
+	lexical_t *lex;
+
+	lex = (lexical_t*)X_MALLOC(sizeof(lexical_t));
+	gc_init_object(&lex->gc, lexical_type);
+
+	lex->symbol = clone_ref(symbol);
+	lex->depth = depth;
+	lex->index = index;
+
+	ref.type = lexical_type;
+	ref.data.object = &lex->gc;
+	return ref;
+}
+
+static void lambda_site_traits_gc_mark(ref_t instance)
+{
+	lambda_site_t *site = (lambda_site_t*)instance.data.object;
+	assert(site);
+	ref_gc_mark(site->form);
+	ref_gc_mark(site->body);
+}
+
+static void lambda_site_traits_gc_release_refs(ref_t instance)
+{
+	lambda_site_t *site = (lambda_site_t*)instance.data.object;
+	assert(site);
+	release_ref(&site->form);
+	release_ref(&site->body);
+}
+
+static void lambda_site_traits_gc_free_mem(ref_t instance)
+{
+	lambda_site_t *site = (lambda_site_t*)instance.data.object;
+	assert(site);
+	X_FREE(site);
+}
+
+static void lambda_site_traits_print(ref_t instance, FILE *to)
+{
+	lambda_site_t *site = (lambda_site_t*)instance.data.object;
+	assert(site);
+	print(site->form, to);
+}
+
+static int lambda_site_traits_eq(ref_t a, ref_t b)
+{
+	return a.data.object == b.data.object;
+}
+
+static int lambda_site_traits_eql(ref_t a, ref_t b)
+{
+	lambda_site_t *as = (lambda_site_t*)a.data.object;
+	lambda_site_t *bs = (lambda_site_t*)b.data.object;
+	return eql(as->form, bs->form);
+}
+
+static ref_t lambda_site_traits_eval(ref_t instance, ref_t context)
+{
+	lambda_site_t *site = (lambda_site_t*)instance.data.object;
+	const type_traits_t *vt = 0;
+	ref_t op, param_list, code, result;
+
+	assert(site && site->form.type == cons_type);
+
+	op = eval(((cons_t*)site->form.data.object)->car, context);
+	if (op.type == foreign_exec_type)
+	{
+		if (op.data.fexec == slfe_fn)
+			vt = function_type;
+		else if (op.data.fexec == slfe_closure)
+			vt = closure_type;
+		else if (op.data.fexec == slfe_macro)
+			vt = macro_type;
+	}
+	release_ref(&op);
+
+	/* the operator has been rebound, so the form means something else now */
+	if (!vt)
+		return eval(site->form, context);
+
+	param_list = cadr(site->form);
+	code = caddr(site->form);
+	result = make_resolved_closure(param_list, code, site->body, context, vt);
+	release_ref(&param_list);
+	release_ref(&code);
+
+	return result;
+}
+
+static const type_traits_t lambda_site_traits =
+{
+	lambda_site_traits_eval,
+	0, /* not executable */
+	lambda_site_traits_print,
+	0, /* no type name (hidden type) */
+	lambda_site_traits_eq,
+	lambda_site_traits_eql,
+	0, /* no hash (hidden type) */
+	gc_traits_addref,
+	gc_traits_release,
+	lambda_site_traits_gc_mark,
+	lambda_site_traits_gc_release_refs,
+	lambda_site_traits_gc_free_mem
+};
+const type_traits_t *lambda_site_type = &lambda_site_traits;
+
+static ref_t make_lambda_site(ref_t form, ref_t body)
+{
+	ref_t ref;
+	lambda_site_t *site;
+
+	site = (lambda_site_t*)X_MALLOC(sizeof(lambda_site_t));
+	gc_init_object(&site->gc, lambda_site_type);
+
+	site->form = clone_ref(form);
+	site->body = clone_ref(body);
+
+	ref.type = lambda_site_type;
+	ref.data.object = &site->gc;
+	return ref;
+}
+
+static void macro_site_traits_gc_mark(ref_t instance)
+{
+	macro_site_t *site = (macro_site_t*)instance.data.object;
+	assert(site);
+	ref_gc_mark(site->form);
+	ref_gc_mark(site->macro);
+	ref_gc_mark(site->expansion);
+}
+
+static void macro_site_traits_gc_release_refs(ref_t instance)
+{
+	macro_site_t *site = (macro_site_t*)instance.data.object;
+	assert(site);
+	release_ref(&site->form);
+	release_ref(&site->macro);
+	release_ref(&site->expansion);
+}
+
+static void macro_site_traits_gc_free_mem(ref_t instance)
+{
+	macro_site_t *site = (macro_site_t*)instance.data.object;
+	assert(site);
+	X_FREE(site);
+}
+
+static void macro_site_traits_print(ref_t instance, FILE *to)
+{
+	macro_site_t *site = (macro_site_t*)instance.data.object;
+	assert(site);
+	print(site->form, to);
+}
+
+static int macro_site_traits_eq(ref_t a, ref_t b)
+{
+	return a.data.object == b.data.object;
+}
+
+static int macro_site_traits_eql(ref_t a, ref_t b)
+{
+	macro_site_t *as = (macro_site_t*)a.data.object;
+	macro_site_t *bs = (macro_site_t*)b.data.object;
+	return eql(as->form, bs->form);
+}
+
+static ref_t macro_site_traits_eval(ref_t instance, ref_t context)
+{
+	macro_site_t *site = (macro_site_t*)instance.data.object;
+	cons_t *form;
+	ref_t op, code, result;
+
+	assert(site && site->form.type == cons_type);
+	form = (cons_t*)site->form.data.object;
+
+	/* the name no longer refers to a macro, so the form means something else now */
+	op = eval(form->car, context);
+	if (op.type != macro_type)
+	{
+		release_ref(&op);
+		return eval(site->form, context);
+	}
+
+	if (_same_ref(op, site->macro))
+		release_ref(&op);
+	else
+	{
+		trace(TRACE_FULL, "expanding %r with args %r", op, form->cdr);
+		release_ref(&site->macro);
+		release_ref(&site->expansion);
+		site->macro = op;
+		site->expansion = apply(op, form->cdr);
+	}
+
+	/* hold on to the expansion, in case evaluating it expands this site again */
+	code = clone_ref(site->expansion);
+	result = eval(code, context);
+	release_ref(&code);
+	return result;
+}
+
+static const type_traits_t macro_site_traits =
+{
+	macro_site_traits_eval,
+	0, /* not executable */
+	macro_site_traits_print,
+	0, /* no type name (hidden type) */
+	macro_site_traits_eq,
+	macro_site_traits_eql,
+	0, /* no hash (hidden type) */
+	gc_traits_addref,
+	gc_traits_release,
+	macro_site_traits_gc_mark,
+	macro_site_traits_gc_release_refs,
+	macro_site_traits_gc_free_mem
+};
+const type_traits_t *macro_site_type = &macro_site_traits;
+
+static void call_site_traits_gc_mark(ref_t instance)
+{
+	call_site_t *site = (call_site_t*)instance.data.object;
+	assert(site);
+	ref_gc_mark(site->form);
+	ref_gc_mark(site->callee);
+}
+
+static void call_site_traits_gc_release_refs(ref_t instance)
+{
+	call_site_t *site = (call_site_t*)instance.data.object;
+	assert(site);
+	release_ref(&site->form);
+	release_ref(&site->callee);
+}
+
+static void call_site_traits_gc_free_mem(ref_t instance)
+{
+	call_site_t *site = (call_site_t*)instance.data.object;
+	assert(site);
+	X_FREE(site);
+}
+
+static void call_site_traits_print(ref_t instance, FILE *to)
+{
+	call_site_t *site = (call_site_t*)instance.data.object;
+	assert(site);
+	print(site->form, to);
+}
+
+static int call_site_traits_eq(ref_t a, ref_t b)
+{
+	return a.data.object == b.data.object;
+}
+
+static int call_site_traits_eql(ref_t a, ref_t b)
+{
+	call_site_t *as = (call_site_t*)a.data.object;
+	call_site_t *bs = (call_site_t*)b.data.object;
+	return eql(as->form, bs->form);
+}
+
+/* returns the site's callee (with a reference), looking it up again if the globals have
+   changed, or nil if the form has to be evaluated as it is instead */
+static ref_t _call_site_callee(call_site_t *site)
+{
+	symbol_t *symb;
+	stack_slot_t *slot;
+
+	symb = ((cons_t*)site->form.data.object)->car.data.symb;
+
+	/* something local shadows the operator, or the site has seen too many different callees */
+	if (symb->bindings.size || site->misses >= CALL_SITE_MAX_MISSES)
+		return nil();
+
+	if (site->epoch != global_binding_epoch)
+	{
+		/* some global has changed, but it needn't have been this one */
+		slot = SYMBOL_GLOBAL_SLOT(symb);
+		if (!slot || !slot->value.type || !slot->value.type->execute)
+			return nil();
+
+		if (!_same_ref(slot->value, site->callee))
+		{
+			++call_site_miss_count;
+			if (site->callee.type)
+				++site->misses;
+			release_ref(&site->callee);
+			site->callee = clone_ref(slot->value);
+		}
+		else
+			++call_site_hit_count;
+
+		site->epoch = global_binding_epoch;
+	}
+	else
+		++call_site_hit_count;
+
+	/* the callee might rebind the operator, which would release the cached one */
+	return clone_ref(site->callee);
+}
+
+static ref_t call_site_traits_eval(ref_t instance, ref_t context)
+{
+	call_site_t *site = (call_site_t*)instance.data.object;
+	ref_t callee, result;
+
+	assert(site && site->form.type == cons_type);
+	trace(TRACE_FULL, "evaluating call: %r", instance);
+
+	callee = _call_site_callee(site);
+	if (callee.type == NIL)
+		return eval(site->form, context);
+
+	result = callee.type->execute(callee, ((cons_t*)site->form.data.object)->cdr, context);
+	release_ref(&callee);
+	return result;
+}
+
+static const type_traits_t call_site_traits =
+{
+	call_site_traits_eval,
+	0, /* not executable */
+	call_site_traits_print,
+	0, /* no type name (hidden type) */
+	call_site_traits_eq,
+	call_site_traits_eql,
+	0, /* no hash (hidden type) */
+	gc_traits_addref,
+	gc_traits_release,
+	call_site_traits_gc_mark,
+	call_site_traits_gc_release_refs,
+	call_site_traits_gc_free_mem
+};
+const type_traits_t *call_site_type = &call_site_traits;
+
+static ref_t make_call_site(ref_t form)
+{
+	ref_t ref;
+	call_site_t *site;
+
+	site = (call_site_t*)X_MALLOC(sizeof(call_site_t));
+	gc_init_object(&site->gc, call_site_type);
+
+	site->form = clone_ref(form);
+	site->callee = nil();
+	site->epoch = global_binding_epoch - 1; /* so that the first call looks the callee up */
+	site->misses = 0;
+
+	ref.type = call_site_type;
+	ref.data.object = &site->gc;
+	return ref;
+}
+
+static void case_site_traits_gc_mark(ref_t instance)
+{
+	case_site_t *site = (case_site_t*)instance.data.object;
+	assert(site);
+	ref_gc_mark(site->form);
+}
+
+static void case_site_traits_gc_release_refs(ref_t instance)
+{
+	case_site_t *site = (case_site_t*)instance.data.object;
+	assert(site);
+	release_ref(&site->form);
+}
+
+static void case_site_traits_gc_free_mem(ref_t instance)
+{
+	case_site_t *site = (case_site_t*)instance.data.object;
+	assert(site);
+	if (site->table)
+	{
+		X_FREE(site->table);
+	}
+	X_FREE(site);
+}
+
+static void case_site_traits_print(ref_t instance, FILE *to)
+{
+	case_site_t *site = (case_site_t*)instance.data.object;
+	assert(site);
+	print(site->form, to);
+}
+
+static int case_site_traits_eq(ref_t a, ref_t b)
+{
+	return a.data.object == b.data.object;
+}
+
+static int case_site_traits_eql(ref_t a, ref_t b)
+{
+	case_site_t *as = (case_site_t*)a.data.object;
+	case_site_t *bs = (case_site_t*)b.data.object;
+	return eql(as->form, bs->form);
+}
+
+static size_t _case_hash(ref_t key)
+{
+	return hash_mix(key.type == symbol_type ? (uint64_t)(uintptr_t)key.data.symb : (uint64_t)key.data.integer);
+}
+
+/* returns the entry for key, or the empty entry where it would go */
+static case_entry_t *_case_site_find(case_site_t *site, ref_t key)
+{
+	case_entry_t *entry;
+	size_t i;
+
+	for (i = _case_hash(key) & site->mask; ; i = (i + 1) & site->mask)
+	{
+		entry = &site->table[i];
+		if (entry->key.type == NIL ||
+			(entry->key.type == key.type &&
+			 (key.type == symbol_type ? entry->key.data.symb == key.data.symb
+			                          : entry->key.data.integer == key.data.integer)))
+			return entry;
+	}
+}
+
+static int _case_key_hashable(ref_t key)
+{
+	return key.type == symbol_type || key.type == integer_type;
+}
+
+static void _case_site_add(case_site_t *site, ref_t key, ref_t body)
+{
+	case_entry_t *entry = _case_site_find(site, key);
+
+	/* an earlier clause with the same key takes precedence */
+	if (entry->key.type == NIL)
+	{
+		entry->key = key;
+		entry->body = body;
+	}
+}
+
+/* the clauses of the site's form, without adding a reference */
+static ref_t _case_clauses(case_site_t *site)
+{
+	ref_t args = ((cons_t*)site->form.data.object)->cdr;
+	return args.type == cons_type ? ((cons_t*)args.data.object)->cdr : nil();
+}
+
+/* counts the keys that can be reached, returning 0 if any of them can't be hashed */
+static int _case_count_keys(case_site_t *site, size_t *count)
+{
+	ref_t it, keys, kt;
+
+	*count = 0;
+	for (it = _case_clauses(site); it.type == cons_type; it = ((cons_t*)it.data.object)->cdr)
+	{
+		if (((cons_t*)it.data.object)->car.type != cons_type)
+			continue;
+
+		keys = ((cons_t*)((cons_t*)it.data.object)->car.data.object)->car;
+		if (case_is_default(keys))
+			break; /* nothing after this can be reached */
+		else if (keys.type == cons_type)
+		{
+			for (kt = keys; kt.type == cons_type; kt = ((cons_t*)kt.data.object)->cdr, ++*count)
+			{
+				if (!_case_key_hashable(((cons_t*)kt.data.object)->car))
+					return 0;
+			}
+		}
+		else if (_case_key_hashable(keys))
+			++*count;
+		else
+			return 0;
+	}
+
+	return 1;
+}
+
+static void _case_site_build(case_site_t *site)
+{
+	ref_t it, kt;
+	cons_t *clause;
+	size_t count, cap;
+
+	if (!_case_count_keys(site, &count))
+	{
+		site->state = CASE_SITE_LINEAR;
+		return;
+	}
+
+	for (cap = 4; cap < count * 2; cap *= 2)
+		;
+	site->table = (case_entry_t*)X_MALLOC(sizeof(case_entry_t) * cap);
+	memset(site->table, 0, sizeof(case_entry_t) * cap);
+	site->mask = cap - 1;
+
+	for (it = _case_clauses(site); it.type == cons_type; it = ((cons_t*)it.data.object)->cdr)
+	{
+		if (((cons_t*)it.data.object)->car.type != cons_type)
+			continue;
+
+		clause = (cons_t*)((cons_t*)it.data.object)->car.data.object;
+		if (case_is_default(clause->car))
+		{
+			site->default_body = clause->cdr;
+			break;
+		}
+		else if (clause->car.type == cons_type)
+		{
+			for (kt = clause->car; kt.type == cons_type; kt = ((cons_t*)kt.data.object)->cdr)
+				_case_site_add(site, ((cons_t*)kt.data.object)->car, clause->cdr);
+		}
+		else
+			_case_site_add(site, clause->car, clause->cdr);
+	}
+
+	site->state = CASE_SITE_HASHED;
+}
+
+/* case_site_traits_eval as a tail_form_t */
+static int _case_site_tail(ref_t instance, ref_t context, ref_t *tail, ref_t *result)
+{
+	case_site_t *site = (case_site_t*)instance.data.object;
+	cons_t *form;
+	stack_slot_t *slot;
+	ref_t key, body;
+	case_entry_t *entry;
+
+	assert(site && site->form.type == cons_type);
+	form = (cons_t*)site->form.data.object;
+
+	/* case has been rebound to something else */
+	slot = SYMBOL_GLOBAL_SLOT(form->car.data.symb);
+	if (!slot || slot->value.type != foreign_exec_type || slot->value.data.fexec != slfe_case)
+	{
+		*result = eval(site->form, context);
+		return 0;
+	}
+
+	if (site->state == CASE_SITE_NEW)
+		_case_site_build(site);
+
+	if (site->state == CASE_SITE_LINEAR || form->cdr.type != cons_type)
+		return slfe_case_tail(form->cdr, context, tail, result);
+
+	key = eval(((cons_t*)form->cdr.data.object)->car, context);
+	if (_case_key_hashable(key) && (entry = _case_site_find(site, key))->key.type != NIL)
+		body = entry->body;
+	else
+		body = site->default_body;
+	release_ref(&key);
+
+	return eval_body_tail(body, context, tail, result);
+}
+
+static ref_t case_site_traits_eval(ref_t instance, ref_t context)
+{
+	ref_t tail, result;
+
+	if (_case_site_tail(instance, context, &tail, &result))
+		return eval(tail, context);
+	return result;
+}
+
+static const type_traits_t case_site_traits =
+{
+	case_site_traits_eval,
+	0, /* not executable */
+	case_site_traits_print,
+	0, /* no type name (hidden type) */
+	case_site_traits_eq,
+	case_site_traits_eql,
+	0, /* no hash (hidden type) */
+	gc_traits_addref,
+	gc_traits_release,
+	case_site_traits_gc_mark,
+	case_site_traits_gc_release_refs,
+	case_site_traits_gc_free_mem
+};
+const type_traits_t *case_site_type = &case_site_traits;
+
+static ref_t make_case_site(ref_t form)
+{
+	ref_t ref;
+	case_site_t *site;
+
+	site = (case_site_t*)X_MALLOC(sizeof(case_site_t));
+	gc_init_object(&site->gc, case_site_type);
+
+	site->form = clone_ref(form);
+	site->state = CASE_SITE_NEW;
+	site->table = 0;
+	site->mask = 0;
+	site->default_body = nil();
+
+	ref.type = case_site_type;
+	ref.data.object = &site->gc;
+	return ref;
+}
+
+static ref_t make_macro_site(ref_t form)
+{
+	ref_t ref;
+	macro_site_t *site;
+
+	site = (macro_site_t*)X_MALLOC(sizeof(macro_site_t));
+	gc_init_object(&site->gc, macro_site_type);
+
+	site->form = clone_ref(form);
+	site->macro = nil();
+	site->expansion = nil();
+
+	ref.type = macro_site_type;
+	ref.data.object = &site->gc;
+	return ref;
+}
+
+/* finds the slot that map_let will give name when it binds the parameter list;
+   slots are allocated in order, once per distinct name.  if name isn't a
+   parameter, index is set to the number of slots that the list binds */
+static int _param_index(ref_t param_list, ref_t name, size_t *index)
+{
+	ref_t it, jt;
+	size_t n = 0;
+
+	for (it = param_list; it.type == cons_type; it = ((cons_t*)it.data.object)->cdr)
+	{
+		ref_t p = param_name(((cons_t*)it.data.object)->car);
+		int seen = 0;
+
+		if (p.type != symbol_type)
+			continue;
+
+		for (jt = param_list; !_same_ref(jt, it); jt = ((cons_t*)jt.data.object)->cdr)
+		{
+			if (_same_ref(param_name(((cons_t*)jt.data.object)->car), p))
+			{
+				seen = 1;
+				break;
+			}
+		}
+
+		if (seen)
+			continue;
+
+		if (_same_ref(p, name))
+		{
+			*index = n;
+			return -1;
+		}
+
+		++n;
+	}
+
+	*index = n;
+	return 0;
+}
+
+size_t lexical_frame_size(ref_t param_list)
+{
+	size_t n;
+	_param_index(param_list, nil(), &n);
+	return n;
+}
+
+static int _is_let(level_t *level, ref_t name)
+{
+	symbol_t **it, **end;
+
+	it = (symbol_t**)level->lets.items;
+	end = (symbol_t**)vector_end(&level->lets);
+	while (it != end)
+	{
+		if (*it == name.data.symb)
+			return -1;
+		++it;
+	}
+
+	return 0;
+}
+
+/* finds the slot that a non-local operator is bound to when the closure is created */
+static stack_slot_t *_operator_slot(level_t *level, ref_t op, ref_t env)
+{
+	level_t *l;
+	size_t idx;
+
+	if (op.type != symbol_type)
+		return 0;
+
+	/* if the operator is a local, its value isn't known yet */
+	for (l = level; l; l = l->outer)
+	{
+		if (_param_index(l->param_list, op, &idx) || _is_let(l, op))
+			return 0;
+	}
+
+	return stack_find((stack_t*)env.data.object, op, 0);
+}
+
+static form_kind_t _classify(level_t *level, ref_t op, ref_t env)
+{
+	stack_slot_t *slot;
+	const form_decl_t *decl;
+
+	/* nb: this assumes that the form's operator won't later be rebound to something
+	   of a different kind; if it is, the lexical references in its arguments still
+	   evaluate correctly, but anything that inspects them will see the wrong thing */
+	slot = _operator_slot(level, op, env);
+	if (!slot)
+		return FORM_UNKNOWN;
+
+	if (slot->value.type == function_type || slot->value.type == foreign_vexec_type ||
+		slot->value.type == struct_proc_type)
+		return FORM_CALL;
+
+	if (slot->value.type == foreign_exec_type)
+	{
+		for (decl = form_decls; decl->fexec; ++decl)
+		{
+			if (decl->fexec == slot->value.data.fexec)
+				return decl->kind;
+		}
+	}
+
+	return FORM_UNKNOWN;
+}
+
+static void _scan_list(level_t *level, ref_t l, ref_t env);
+
+/* first pass over a body: find the names it binds and whether it does anything unpredictable */
+static void _scan(level_t *level, ref_t form, ref_t env)
+{
+	cons_t *cons, *clause;
+	ref_t it;
+
+	if (form.type != cons_type)
+		return;
+
+	cons = (cons_t*)form.data.object;
+	switch (_classify(level, cons->car, env))
+	{
+	case FORM_QUOTE:
+		break;
+	case FORM_LAMBDA: /* the nested body's bindings go in its own frame */
+		level->captures = 1;
+		break;
+	case FORM_CALL:
+		_scan_list(level, cons->cdr, env);
+		break;
+	case FORM_COND:
+		for (it = cons->cdr; it.type == cons_type; it = ((cons_t*)it.data.object)->cdr)
+		{
+			clause = (cons_t*)it.data.object;
+			if (clause->car.type == cons_type)
+				_scan_list(level, clause->car, env);
+		}
+		break;
+	case FORM_CASE:
+		if (cons->cdr.type == cons_type)
+		{
+			_scan(level, ((cons_t*)cons->cdr.data.object)->car, env);
+			for (it = ((cons_t*)cons->cdr.data.object)->cdr; it.type == cons_type; it = ((cons_t*)it.data.object)->cdr)
+			{
+				clause = (cons_t*)it.data.object;
+				if (clause->car.type == cons_type)
+					_scan_list(level, ((cons_t*)clause->car.data.object)->cdr, env);
+			}
+		}
+		break;
+	case FORM_LET:
+		if (cons->cdr.type == cons_type)
+		{
+			ref_t name = ((cons_t*)cons->cdr.data.object)->car;
+			if (name.type == symbol_type && !_is_let(level, name))
+				*(symbol_t**)vector_insert(&level->lets, VECTOR_NPOS) = name.data.symb;
+			else if (name.type != symbol_type)
+				level->dirty = 1;
+			_scan_list(level, ((cons_t*)cons->cdr.data.object)->cdr, env);
+		}
+		break;
+	case FORM_SET:
+		if (cons->cdr.type == cons_type)
+			_scan_list(level, ((cons_t*)cons->cdr.data.object)->cdr, env);
+		break;
+	default:
+		level->dirty = 1;
+		level->captures = 1;
+		break;
+	}
+}
+
+static void _scan_list(level_t *level, ref_t l, ref_t env)
+{
+	for (; l.type == cons_type; l = ((cons_t*)l.data.object)->cdr)
+		_scan(level, ((cons_t*)l.data.object)->car, env);
+}
+
+static ref_t _resolve_symbol(level_t *level, ref_t name, ref_t env)
+{
+	level_t *l;
+	size_t depth = 0, idx;
+	stack_slot_t *slot;
+
+	for (l = level; l; l = l->outer, ++depth)
+	{
+		if (_param_index(l->param_list, name, &idx))
+			return make_lexical(name, depth, idx);
+
+		/* the name is (or might be) bound somewhere in this frame other than in
+		   a parameter slot, so it can't be given a fixed position */
+		if (_is_let(l, name) || l->dirty)
+			return clone_ref(name);
+	}
+
+	/* the name will be looked up in the closure's environment; if it is a constant
+	   there whose value evaluates to itself, then the value can be used directly */
+	slot = stack_find((stack_t*)env.data.object, name, 0);
+	if (slot && (slot->flags & STACK_SLOT_CONST) &&
+		slot->value.type && !slot->value.type->eval)
+	{
+		return clone_ref(slot->value);
+	}
+
+	return clone_ref(name);
+}
+
+static ref_t _resolve_body(level_t *outer, ref_t param_list, ref_t code, ref_t env, int expand);
+static ref_t _rewrite(level_t *level, ref_t form, ref_t env);
+
+/* rewrites every item in a list, sharing as much of the list as possible */
+static ref_t _rewrite_list(level_t *level, ref_t l, ref_t env)
+{
+	ref_t lar, ldr, result;
+	cons_t *cons;
+
+	if (l.type != cons_type)
+		return clone_ref(l);
+
+	cons = (cons_t*)l.data.object;
+	lar = _rewrite(level, cons->car, env);
+	ldr = _rewrite_list(level, cons->cdr, env);
+
+	if (_same_ref(lar, cons->car) && _same_ref(ldr, cons->cdr))
+		result = clone_ref(l);
+	else
+		result = make_cons(lar, ldr);
+
+	release_ref(&lar);
+	release_ref(&ldr);
+	return result;
+}
+
+/* rewrites the tail of a list after skipping n items */
+static ref_t _rewrite_tail(level_t *level, ref_t l, size_t n, ref_t env)
+{
+	ref_t ldr, result;
+	cons_t *cons;
+
+	if (n == 0)
+		return _rewrite_list(level, l, env);
+
+	if (l.type != cons_type)
+		return clone_ref(l);
+
+	cons = (cons_t*)l.data.object;
+	ldr = _rewrite_tail(level, cons->cdr, n - 1, env);
+
+	if (_same_ref(ldr, cons->cdr))
+		result = clone_ref(l);
+	else
+		result = make_cons(cons->car, ldr);
+
+	release_ref(&ldr);
+	return result;
+}
+
+/* rewrites each clause in a list of them, after skipping the first n items of each */
+static ref_t _rewrite_clauses(level_t *level, ref_t clauses, size_t n, ref_t env)
+{
+	ref_t lar, ldr, result;
+	cons_t *cons;
+
+	if (clauses.type != cons_type)
+		return clone_ref(clauses);
+
+	cons = (cons_t*)clauses.data.object;
+	lar = _rewrite_tail(level, cons->car, n, env);
+	ldr = _rewrite_clauses(level, cons->cdr, n, env);
+
+	if (_same_ref(lar, cons->car) && _same_ref(ldr, cons->cdr))
+		result = clone_ref(clauses);
+	else
+		result = make_cons(lar, ldr);
+
+	release_ref(&lar);
+	release_ref(&ldr);
+	return result;
+}
+
+/* the nested closure's code is resolved now, as part of the enclosing body, and kept
+   on a site alongside the original form; the closures made from it get the form's
+   code as written, and the resolved code as their body */
+static ref_t _rewrite_lambda(level_t *level, ref_t form, ref_t env)
+{
+	ref_t param_list, code, new_code, rest, result;
+
+	param_list = cadr(form);
+	code = caddr(form);
+
+	new_code = _resolve_body(level, param_list, code, env, level->expand);
+	if (_same_ref(new_code, code))
+		result = clone_ref(form);
+	else if (!level->expand)
+		result = make_lambda_site(form, new_code);
+	else
+	{
+		/* expanded code is for reading, so the form is rebuilt around the new code:
+		   (op param-list new-code . whatever-else) */
+		ref_t op, tail, ldr;
+		op = car(form);
+		ldr = cdr(form);
+		rest = cdr(ldr);
+		release_ref(&ldr);
+		ldr = cdr(rest);
+		release_ref(&rest);
+
+		tail = make_cons(new_code, ldr);
+		rest = make_cons(param_list, tail);
+		result = make_cons(op, rest);
+
+		release_ref(&op);
+		release_ref(&ldr);
+		release_ref(&tail);
+		release_ref(&rest);
+	}
+
+	release_ref(&param_list);
+	release_ref(&code);
+	release_ref(&new_code);
+	return result;
+}
+
+static ref_t _rewrite(level_t *level, ref_t form, ref_t env)
+{
+	cons_t *cons;
+
+	if (form.type == symbol_type)
+		return level->expand ? clone_ref(form) : _resolve_symbol(level, form, env);
+
+	if (form.type != cons_type)
+		return clone_ref(form);
+
+	cons = (cons_t*)form.data.object;
+	switch (_classify(level, cons->car, env))
+	{
+	case FORM_CALL:
+		{
+			ref_t result, site;
+
+			result = _rewrite_list(level, form, env); /* the operator may be a constant */
+			if (level->expand || result.type != cons_type ||
+				((cons_t*)result.data.object)->car.type != symbol_type)
+				return result;
+
+			site = make_call_site(result);
+			release_ref(&result);
+			return site;
+		}
+	case FORM_COND:
+		{
+			ref_t clauses, result;
+			clauses = _rewrite_clauses(level, cons->cdr, 0, env);
+			if (_same_ref(clauses, cons->cdr))
+				result = clone_ref(form);
+			else
+				result = make_cons(cons->car, clauses);
+			release_ref(&clauses);
+			return result;
+		}
+	case FORM_CASE:
+		{
+			ref_t key, clauses, args, result, site;
+
+			if (cons->cdr.type != cons_type)
+				return clone_ref(form);
+
+			/* the keys are left alone, since they aren't evaluated */
+			key = _rewrite(level, ((cons_t*)cons->cdr.data.object)->car, env);
+			clauses = _rewrite_clauses(level, ((cons_t*)cons->cdr.data.object)->cdr, 1, env);
+			if (_same_ref(key, ((cons_t*)cons->cdr.data.object)->car) &&
+				_same_ref(clauses, ((cons_t*)cons->cdr.data.object)->cdr))
+				result = clone_ref(form);
+			else
+			{
+				args = make_cons(key, clauses);
+				result = make_cons(cons->car, args);
+				release_ref(&args);
+			}
+			release_ref(&key);
+			release_ref(&clauses);
+
+			if (level->expand || cons->car.type != symbol_type)
+				return result;
+
+			site = make_case_site(result);
+			release_ref(&result);
+			return site;
+		}
+	case FORM_LET:
+	case FORM_SET:
+		return _rewrite_tail(level, form, 2, env);
+	case FORM_LAMBDA:
+		return _rewrite_lambda(level, form, env);
+	default:
+		{
+			/* macro calls keep their expansion; the arguments aren't evaluated, so they're left alone */
+			stack_slot_t *slot = _operator_slot(level, cons->car, env);
+			if (slot && slot->value.type == macro_type)
+			{
+				ref_t macro, expansion, result;
+
+				if (!level->expand)
+					return make_macro_site(form);
+
+				/* the macro may bind names of its own, which would move the slot */
+				macro = clone_ref(slot->value);
+				expansion = apply(macro, cons->cdr);
+				result = _rewrite(level, expansion, env);
+				release_ref(&macro);
+				release_ref(&expansion);
+				return result;
+			}
+			return clone_ref(form);
+		}
+	}
+}
+
+static ref_t _resolve_body(level_t *outer, ref_t param_list, ref_t code, ref_t env, int expand)
+{
+	level_t level;
+	ref_t result;
+
+	/* already done, as part of resolving an enclosing closure */
+	if (_is_code(code) && (code.data.object->flags & GC_FLAG_RESOLVED))
+		return clone_ref(code);
+
+	level.outer = outer;
+	level.param_list = param_list;
+	level.dirty = 0;
+	level.captures = 0;
+	level.expand = expand;
+	VECTOR_INIT_TYPE(&level.lets, symbol_t*);
+
+	_scan(&level, code, env);
+	result = _rewrite(&level, code, env);
+
+	vector_clear(&level.lets);
+
+	/* expanded code still has to be resolved when a closure is made from it */
+	if (!expand && _is_code(result))
+	{
+		result.data.object->flags |= GC_FLAG_RESOLVED;
+		if (!level.captures)
+			result.data.object->flags |= GC_FLAG_LEAF;
+	}
+
+	return result;
+}
+
+ref_t lexical_resolve(ref_t param_list, ref_t code, ref_t env)
+{
+	if (env.type != stack_type)
+		return clone_ref(code);
+
+	return _resolve_body(0, param_list, code, env, 0);
+}
+
+int lexical_body_is_leaf(ref_t body)
+{
+	return !_is_code(body) || (body.data.object->flags & GC_FLAG_LEAF);
+}
+
+ref_t lexical_expand(ref_t form, ref_t env)
+{
+	if (env.type != stack_type)
+		return clone_ref(form);
+
+	return _resolve_body(0, nil(), form, env, 1);
+}
+
+/* returns the tail_form_t for a built-in form, or 0 if it doesn't have one */
+static tail_form_t _tail_form(ref_t op)
+{
+	const form_decl_t *decl;
+
+	if (op.type != foreign_exec_type)
+		return 0;
+
+	for (decl = form_decls; decl->fexec; ++decl)
+	{
+		if (decl->fexec == op.data.fexec)
+			return decl->tail;
+	}
+
+	return 0;
+}
+
+ref_t lexical_eval_tail(ref_t body, ref_t env, ref_t *callee, ref_t *args)
+{
+	ref_t e = body, op, form, new_form, result;
+	tail_form_t tail_form;
+
+	*callee = nil();
+
+	for (;;)
+	{
+		stack_enter(env);
+
+		if (e.type == case_site_type)
+		{
+			if (!_case_site_tail(e, env, &e, &result))
+				return result;
+			continue;
+		}
+
+		/* find out what is being called, the same way call sites and conses do */
+		if (e.type == call_site_type)
+		{
+			form = ((call_site_t*)e.data.object)->form;
+			op = _call_site_callee((call_site_t*)e.data.object);
+			if (op.type == NIL)
+				return eval(form, env);
+		}
+		else if (e.type == cons_type)
+		{
+			form = e;
+			op = ((cons_t*)form.data.object)->car;
+			if (op.type && op.type->execute)
+				op = clone_ref(op);
+			else if (op.type && op.type->eval)
+			{
+				op = eval(op, env);
+				if (!op.type || !op.type->execute)
+				{
+					/* as cons_traits_eval does, try the form again with what the operator evaluated to */
+					new_form = make_cons(op, ((cons_t*)form.data.object)->cdr);
+					result = eval(new_form, env);
+					release_ref(&new_form);
+					release_ref(&op);
+					return result;
+				}
+			}
+			else
+				return eval(form, env);
+		}
+		else
+			return eval(e, env);
+
+		if (op.type == function_type || op.type == closure_type)
+		{
+			*callee = op;
+			*args = ((cons_t*)form.data.object)->cdr;
+			return nil();
+		}
+
+		tail_form = _tail_form(op);
+		if (!tail_form)
+		{
+			result = op.type->execute(op, ((cons_t*)form.data.object)->cdr, env);
+			release_ref(&op);
+			return result;
+		}
+
+		release_ref(&op);
+		if (!tail_form(((cons_t*)form.data.object)->cdr, env, &e, &result))
+			return result;
+	}
+}
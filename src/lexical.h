@@ -0,0 +1,113 @@
+/* vim: set ts=4 sts=4 sw=4 noet ai: */
+#ifndef LEXICAL_H
+#define LEXICAL_H
+
+#include "gc.h"
+#include "ref.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* a variable reference that has been resolved when its closure was created:
+   it names the slot at 'index' in the frame 'depth' stacks up from the one
+   it is evaluated in */
+typedef struct lexical_ts
+{
+	gc_object_t gc;
+	ref_t symbol; /* the name it replaces; used for printing and to check the slot */
+	size_t depth;
+	size_t index;
+} lexical_t;
+
+/* a fn, closure or macro form inside a closure body, whose own code was resolved
+   along with the body.  the form is kept as it was written, so that the closures
+   it makes have the original code, and the resolved code is used as their body */
+typedef struct lambda_site_ts
+{
+	gc_object_t gc;
+	ref_t form; /* the original (op param-list code) form */
+	ref_t body; /* code, resolved */
+} lambda_site_t;
+
+/* a call to a macro: the expansion is kept once it has been made, so that the
+   macro only runs again if its name is rebound to a different macro */
+typedef struct macro_site_ts
+{
+	gc_object_t gc;
+	ref_t form; /* the original (macro args...) form */
+	ref_t macro; /* the macro that made expansion, or nil if it hasn't been expanded yet */
+	ref_t expansion;
+} macro_site_t;
+
+/* a call whose operator is a global: the callee is remembered along with the
+   global_binding_epoch it was looked up in, so that the operator only has to be
+   looked up again when the globals have changed */
+typedef struct call_site_ts
+{
+	gc_object_t gc;
+	ref_t form; /* the (operator args...) form, with its arguments already resolved */
+	ref_t callee; /* nil if the site hasn't been called yet */
+	size_t epoch;
+	size_t misses; /* number of times the callee turned out to have changed */
+} call_site_t;
+
+/* an entry in a case_site_t's jump table */
+typedef struct case_entry_ts
+{
+	ref_t key; /* a symbol or integer; nil for an empty entry */
+	ref_t body; /* the rest of the clause the key is from (not referenced, since the form holds it) */
+} case_entry_t;
+
+/* a case form: the first time it is evaluated, its keys are put in a hash table, so
+   that finding the clause to evaluate takes the same time however many there are */
+typedef struct case_site_ts
+{
+	gc_object_t gc;
+	ref_t form; /* the (case key clause...) form, with the key and bodies already resolved */
+	int state; /* CASE_SITE_* */
+	case_entry_t *table;
+	size_t mask; /* table capacity - 1 (capacity is a power of two) */
+	ref_t default_body; /* the body of the t or otherwise clause, if there is one */
+} case_site_t;
+
+#define CASE_SITE_NEW (0) /* the table hasn't been built yet */
+#define CASE_SITE_HASHED (1)
+#define CASE_SITE_LINEAR (2) /* some of the keys can't be hashed, so the clauses are checked in order */
+
+/* after this many changes of callee a site stops caching, and just evaluates its form */
+#define CALL_SITE_MAX_MISSES (8)
+
+extern int call_site_hit_count;
+extern int call_site_miss_count;
+
+/* returns code with references to the closure's parameters (and to the parameters of
+   closures nested inside it) replaced by lexical references, wherever the shape of the
+   environment can be worked out in advance.  anything else is left to be looked up
+   by name.  parts of the tree that don't change are shared with code */
+ref_t lexical_resolve(ref_t param_list, ref_t code, ref_t env);
+
+/* returns 1 unless body (as returned by lexical_resolve) might keep a reference
+   to the frame that it is evaluated in */
+int lexical_body_is_leaf(ref_t body);
+
+/* returns form with every macro call in a position that is known to be evaluated
+   replaced by its expansion, looking macros up in env.  quoted data and the arguments
+   of forms the resolver doesn't understand are left as they are */
+ref_t lexical_expand(ref_t form, ref_t env);
+
+/* evaluates body (as returned by lexical_resolve) in env, except that if it ends with a
+   call to a function or closure (directly, or through the last form of if, when, unless,
+   and, or, cond, case or do), that call isn't made: its callee is put in *callee, with a
+   reference, and its unevaluated arguments in *args, without one, since they belong to
+   body.  otherwise *callee is nil, and the value of body is returned */
+ref_t lexical_eval_tail(ref_t body, ref_t env, ref_t *callee, ref_t *args);
+
+/* returns the number of slots that binding param_list will add to a frame */
+size_t lexical_frame_size(ref_t param_list);
+
+#ifdef __cplusplus
+} /* end extern "C" */
+#endif
+
+#endif
@@ -6,6 +6,7 @@
 #include "symbol.h"
 #include "closure.h"
 #include "core_lib.h"
+#include "lexical.h"
 
 #include "str.h"
 #include "cmd_opt.h"
@@ -14,6 +15,7 @@ static char *output_fname = 0;
 static int quiet_flag = 0;
 static int help_flag = 0;
 static int stats_flag = 0;
+static int expand_flag = 0;
 static char *trace_file_fname = 0;
 static char *input_fname = 0;
 
@@ -23,6 +25,7 @@ static cmd_opt_decl_t cmd_opt_decls[] =
 	{"o", "output", CMO_STRING, &output_fname, 0, "Specifies the eval output file."},
 	{"q", "quiet", CMO_FLAG, &quiet_flag, 0, "Don't output the results of top-level evals."},
 	{"s", "stats", CMO_FLAG, &stats_flag, 0, "Enable tracking certain statistics"},
+	{"e", "expand", CMO_FLAG, &expand_flag, 0, "Expand the macros in each top-level form before evaluating it."},
 	{0, "trace-file", CMO_STRING, &trace_file_fname, 0, "Specify a file to output traces and stack dumps to."},
 	{0, 0, CMO_STRING, &input_fname, 0, "The script to run."},
 	{0}
@@ -152,7 +155,7 @@ ref_t slfe_profile(ref_t args, ref_t assoc)
 
 void print_usage()
 {
-	printf("Usage: smalisp [-h or --help] [-q or --quiet] [-s or --stats] [--trace-file=<trace-output-file>] [-o or --output=<output-file>] [ <input-file> ]\n\n");
+	printf("Usage: smalisp [-h or --help] [-q or --quiet] [-s or --stats] [-e or --expand] [--trace-file=<trace-output-file>] [-o or --output=<output-file>] [ <input-file> ]\n\n");
 	print_option_list(cmd_opt_decls);
 	printf("\n");
 }
@@ -162,7 +165,7 @@ int main(int argc, char *argv[])
 	int result = 0;
 	ref_t val, answer, assoc, name;
 	FILE *input_fl = stdin, *output_fl = stdout;
-	clock_t start_time, end_time;
+	clock_t start_time, end_time, expand_time = 0;
 	
 #define FREE_AND_RETURN(x) {result = x; goto free_and_return;}
 
@@ -237,6 +240,15 @@ int main(int argc, char *argv[])
 			printf("> ");
 
 		val = read(input_fl);
+		if (expand_flag)
+		{
+			ref_t expanded;
+			clock_t expand_start = clock();
+			expanded = lexical_expand(val, assoc);
+			expand_time += clock() - expand_start;
+			release_ref(&val);
+			val = expanded;
+		}
 		answer = eval(val, assoc);
 		release_ref(&val);
 		if (!quiet_flag)
@@ -245,7 +257,7 @@ int main(int argc, char *argv[])
 			fflush(output_fl);
 		}
 		release_ref(&answer);
-		collect_garbage();
+		collect_garbage_if_needed();
 	}
 
 	stack_enter(nil());
@@ -253,17 +265,26 @@ int main(int argc, char *argv[])
 	release_ref(&assoc);
 
 	collect_garbage();
+	stack_global_cleanup();
+	stack_frame_global_cleanup();
 
 	end_time = clock();
 
 	if (trace_fl)
+	{
 		fprintf(trace_fl, "Total time taken: %f seconds\n", (float)(end_time - start_time) / (float)CLOCKS_PER_SEC);
+		if (expand_flag)
+			fprintf(trace_fl, "Time spent expanding macros: %f seconds\n", (float)expand_time / (float)CLOCKS_PER_SEC);
+	}
 
 #undef FREE_AND_RETURN
 
 free_and_return:
 	if (trace_fl && stats_flag)
+	{
 		fprintf(trace_fl, "Total symbol evals: %d; total stack switches: %d\n", symbol_eval_count, stack_switch_count);
+		fprintf(trace_fl, "Call site cache: %d hits, %d misses\n", call_site_hit_count, call_site_miss_count);
+	}
 
 	if (input_fl != stdin) fclose(input_fl);
 	if (output_fl != stdout) fclose(output_fl);
@@ -31,6 +31,9 @@
   malloc and free with calls to the macros X_MALLOC and X_FREE, in order to
   interface with the aforementioned memory checking utility functions.
 
+  The rbtn_floor, rbtn_ceiling, rbtn_first and rbtn_next functions have also
+  been added, for ordered searches and in-order walks.
+
 */
 
 #include "global.h"
@@ -379,6 +382,78 @@ int rbtn_del(rbtn_t **root, int key, void* data, int (*compar)(void*, void*),
     return 1;
 }
 
+/* Find the node with the greatest data not above 'data' */
+rbtn_t *rbtn_floor(rbtn_t *root, void *data, int (*compar)(void*, void*))
+{
+	rbtn_t *current, *best = NULL;
+	int c;
+
+	current = (root == NULL) ? RBTN_NIL : root;
+	while (current != RBTN_NIL)
+	{
+		c = compar(data, current->data);
+		if (c == 0)
+			return current;
+
+		if (c > 0)
+		{
+			best = current;
+			current = current->right;
+		}
+		else
+			current = current->left;
+	}
+
+	return best;
+}
+
+/* Find the node with the least data not below 'data' */
+rbtn_t *rbtn_ceiling(rbtn_t *root, void *data, int (*compar)(void*, void*))
+{
+	rbtn_t *current, *best = NULL;
+	int c;
+
+	current = (root == NULL) ? RBTN_NIL : root;
+	while (current != RBTN_NIL)
+	{
+		c = compar(data, current->data);
+		if (c == 0)
+			return current;
+
+		if (c < 0)
+		{
+			best = current;
+			current = current->left;
+		}
+		else
+			current = current->right;
+	}
+
+	return best;
+}
+
+/* Find the leftmost node */
+rbtn_t *rbtn_first(rbtn_t *root)
+{
+	if ((root == NULL) || (root == RBTN_NIL))
+		return NULL;
+
+	while (root->left != RBTN_NIL)
+		root = root->left;
+	return root;
+}
+
+/* Find the node after a given one, in left to right order */
+rbtn_t *rbtn_next(rbtn_t *node)
+{
+	if (node->right != RBTN_NIL)
+		return rbtn_first(node->right);
+
+	while (node->parent && (node == node->parent->right))
+		node = node->parent;
+	return node->parent;
+}
+
 /* Traverse the tree bottom-up, left-right */
 void rbtn_traverse(rbtn_t *root, void (*func)(void*))
 {
@@ -68,6 +68,17 @@ rbtn_t* rbtn_findins(rbtn_t **root, int key, void *data, int force,
  */
 int rbtn_del(rbtn_t **root, int key, void *data, int (*compar)(void*, void*),
     int sortbykey, int nofixup);
+/* Find the node with the greatest data not above 'data' (the floor), or the
+ *  least data not below it (the ceiling), for a tree sorted by data.
+ *  Returns NULL if there is no such node
+ */
+rbtn_t* rbtn_floor(rbtn_t *root, void *data, int (*compar)(void*, void*));
+rbtn_t* rbtn_ceiling(rbtn_t *root, void *data, int (*compar)(void*, void*));
+/* Walk a tree in left-to-right order: the first node, and the node after a
+ *  given one. Both return NULL when there are no more nodes
+ */
+rbtn_t* rbtn_first(rbtn_t *root);
+rbtn_t* rbtn_next(rbtn_t *node);
 /* Traverse a tree bottom-up, left-to-right, and call a function on nodes */
 void rbtn_traverse(rbtn_t *root, void (*func)(void*));
 
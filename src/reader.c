@@ -8,6 +8,7 @@
 #include "gc.h"
 #include "symbol.h"
 #include "cons.h"
+#include "sl_vector.h"
 
 #define MAX_PEEK_BUF (64)
 static char peek_buf[MAX_PEEK_BUF] = {0};
@@ -92,6 +93,40 @@ static ref_t _read_quoted();
 static ref_t _read_number();
 static ref_t _read_symbol();
 
+/* reads #(item...) into a vector; the items aren't evaluated */
+static ref_t _read_vector()
+{
+	ref_t result, item;
+	sl_vector_t *vec;
+	int c;
+
+	_get(); /* skip the opening bracket (the # has already gone) */
+
+	result = make_sl_vector(0, nil());
+	vec = (sl_vector_t*)result.data.object;
+
+	for (;;)
+	{
+		_skip_whitespace();
+		c = _peek();
+		if (c == -1)
+		{
+			LOG_ERROR("input ended without a closing bracket");
+			break;
+		}
+		else if (c == ')')
+		{
+			_get(); /* eat the ) */
+			break;
+		}
+
+		item = read(source_file);
+		*(ref_t*)vector_insert(&vec->items, VECTOR_NPOS) = item;
+	}
+
+	return result;
+}
+
 static ref_t _read_cons_cdr()
 {
 	int c;
@@ -309,7 +344,16 @@ static ref_t _read_number()
 	}
 
 	if (is_int)
-		ref = make_integer(str_to_int(&buf));
+	{
+		ref = make_integer(str_to_int64(&buf));
+
+		/* as with arithmetic that overflows, an integer that doesn't fit becomes a real */
+		if (errno == ERANGE)
+		{
+			LOG_WARNING_X("%s doesn't fit in an integer; reading it as a real", buf.c_str);
+			ref = make_real(str_to_double(&buf));
+		}
+	}
 	else
 		ref = make_real(str_to_double(&buf));
 
@@ -492,6 +536,12 @@ ref_t read(FILE *in)
 		return nil();
 	case '"':
 		return _read_string();
+	case '#':
+		_get();
+		if (_peek() == '(')
+			return _read_vector();
+		_unget('#'); /* otherwise, it's a symbol */
+		return _read_symbol();
 	case '-': case '+': case '.':
 	case '0': case '1': case '2': case '3': case '4':
 	case '5': case '6': case '7': case '8': case '9':
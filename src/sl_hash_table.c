@@ -0,0 +1,301 @@
+/* vim: set ts=4 sts=4 sw=4 noet ai: */
+#include "global.h"
+
+#include "smalisp.h"
+#include "gc.h"
+#include "sl_hash_table.h"
+
+#define HASH_TABLE_MIN_BUCKETS (8)
+/* the number of old buckets each operation moves while the table is growing.  the table
+   grows when it has as many entries as buckets, and the new table doesn't fill until that
+   many entries again have been added, so any step of at least one finishes in time */
+#define HASH_TABLE_MOVE_STEP (4)
+
+static void _free_chains(hash_entry_t **buckets, size_t mask)
+{
+	hash_entry_t *e, *next;
+	size_t n;
+
+	if (!buckets)
+		return;
+
+	for (n = 0; n <= mask; ++n)
+	{
+		for (e = buckets[n]; e; e = next)
+		{
+			next = e->next;
+			X_FREE(e);
+		}
+	}
+}
+
+/* calls fn on the key and value of every entry */
+static void _for_each_ref(sl_hash_table_t *table, void (*fn)(ref_t *ref))
+{
+	hash_table_iter_t it;
+	hash_entry_t *e;
+
+	hash_table_iter_init(&it, table);
+	while (hash_table_iter_next(&it, 0, 0))
+	{
+		e = it.entry;
+		fn(&e->key);
+		fn(&e->value);
+	}
+}
+
+static void _mark_ref(ref_t *ref)
+{
+	ref_gc_mark(*ref);
+}
+
+static void hash_table_traits_gc_mark(ref_t instance)
+{
+	_for_each_ref((sl_hash_table_t*)instance.data.object, _mark_ref);
+}
+
+static void hash_table_traits_gc_release_refs(ref_t instance)
+{
+	_for_each_ref((sl_hash_table_t*)instance.data.object, release_ref);
+}
+
+static void hash_table_traits_gc_free_mem(ref_t instance)
+{
+	sl_hash_table_t *table = (sl_hash_table_t*)instance.data.object;
+
+	assert(table);
+
+	_free_chains(table->buckets, table->mask);
+	_free_chains(table->old_buckets, table->old_mask);
+	X_FREE(table->buckets);
+	X_FREE(table->old_buckets);
+	X_FREE(table);
+}
+
+static void hash_table_traits_print(ref_t instance, FILE *to)
+{
+	sl_hash_table_t *table = (sl_hash_table_t*)instance.data.object;
+	fprintf(to, "#<hash-table %s %lu>", table->is_eql ? "eql" : "eq", (unsigned long)table->count);
+}
+
+static ref_t hash_table_traits_type_name(ref_t instance)
+{
+	return make_symbol("hash-table", 0);
+}
+
+static int hash_table_traits_eq(ref_t a, ref_t b)
+{
+	return a.data.object == b.data.object;
+}
+
+static const type_traits_t hash_table_traits =
+{
+	0, /* not evaluable */
+	0, /* not executable */
+	hash_table_traits_print,
+	hash_table_traits_type_name,
+	hash_table_traits_eq,
+	hash_table_traits_eq, /* eq and eql do the same thing for hash tables */
+	hash_eq,
+	gc_traits_addref,
+	gc_traits_release,
+	hash_table_traits_gc_mark,
+	hash_table_traits_gc_release_refs,
+	hash_table_traits_gc_free_mem
+};
+const type_traits_t *hash_table_type = &hash_table_traits;
+
+static hash_entry_t **_alloc_buckets(size_t n)
+{
+	hash_entry_t **buckets = (hash_entry_t**)X_MALLOC(n * sizeof(hash_entry_t*));
+	memset(buckets, 0, n * sizeof(hash_entry_t*));
+	return buckets;
+}
+
+ref_t make_hash_table(int is_eql)
+{
+	ref_t ref;
+	sl_hash_table_t *table;
+
+	table = (sl_hash_table_t*)X_MALLOC(sizeof(sl_hash_table_t));
+	gc_init_object(&table->gc, hash_table_type);
+
+	table->is_eql = is_eql;
+	table->count = 0;
+	table->buckets = _alloc_buckets(HASH_TABLE_MIN_BUCKETS);
+	table->mask = HASH_TABLE_MIN_BUCKETS - 1;
+	table->old_buckets = 0;
+	table->old_mask = 0;
+	table->moved = 0;
+
+	ref.type = hash_table_type;
+	ref.data.object = &table->gc;
+	return ref;
+}
+
+/* moves up to n buckets of the old table into the new one */
+static void _move_buckets(sl_hash_table_t *table, size_t n)
+{
+	hash_entry_t *e, *next;
+
+	while (table->old_buckets && n--)
+	{
+		for (e = table->old_buckets[table->moved]; e; e = next)
+		{
+			next = e->next;
+			e->next = table->buckets[e->hash & table->mask];
+			table->buckets[e->hash & table->mask] = e;
+		}
+		table->old_buckets[table->moved] = 0;
+
+		if (table->moved++ == table->old_mask)
+		{
+			X_FREE(table->old_buckets);
+			table->old_buckets = 0;
+			table->old_mask = 0;
+			table->moved = 0;
+		}
+	}
+}
+
+static size_t _hash(sl_hash_table_t *table, ref_t key)
+{
+	return table->is_eql ? hash_eql(key) : hash_eq(key);
+}
+
+static int _same_key(sl_hash_table_t *table, ref_t a, ref_t b)
+{
+	return table->is_eql ? eql(a, b) : eq(a, b);
+}
+
+/* returns the link that points at key's entry (or at the null at the end of its chain) */
+static hash_entry_t **_find_link(sl_hash_table_t *table, ref_t key, size_t hash)
+{
+	hash_entry_t **link;
+
+	for (link = &table->buckets[hash & table->mask]; *link; link = &(*link)->next)
+	{
+		if ((*link)->hash == hash && _same_key(table, (*link)->key, key))
+			return link;
+	}
+
+	/* the key may not have been moved out of the old table yet */
+	if (table->old_buckets && (hash & table->old_mask) >= table->moved)
+	{
+		hash_entry_t **old_link;
+
+		for (old_link = &table->old_buckets[hash & table->old_mask]; *old_link; old_link = &(*old_link)->next)
+		{
+			if ((*old_link)->hash == hash && _same_key(table, (*old_link)->key, key))
+				return old_link;
+		}
+	}
+
+	return link;
+}
+
+hash_entry_t *hash_table_find(sl_hash_table_t *table, ref_t key)
+{
+	_move_buckets(table, HASH_TABLE_MOVE_STEP);
+	return *_find_link(table, key, _hash(table, key));
+}
+
+void hash_table_set(sl_hash_table_t *table, ref_t key, ref_t value)
+{
+	size_t hash = _hash(table, key);
+	hash_entry_t **link, *e;
+	ref_t old;
+
+	_move_buckets(table, HASH_TABLE_MOVE_STEP);
+
+	link = _find_link(table, key, hash);
+	if (*link)
+	{
+		old = (*link)->value;
+		(*link)->value = clone_ref(value);
+		release_ref(&old);
+		return;
+	}
+
+	/* start growing once there are as many entries as buckets */
+	if (table->count > table->mask && !table->old_buckets)
+	{
+		table->old_buckets = table->buckets;
+		table->old_mask = table->mask;
+		table->moved = 0;
+		table->mask = table->mask * 2 + 1;
+		table->buckets = _alloc_buckets(table->mask + 1);
+	}
+
+	e = (hash_entry_t*)X_MALLOC(sizeof(hash_entry_t));
+	e->hash = hash;
+	e->key = clone_ref(key);
+	e->value = clone_ref(value);
+	e->next = table->buckets[hash & table->mask];
+	table->buckets[hash & table->mask] = e;
+	++table->count;
+}
+
+int hash_table_remove(sl_hash_table_t *table, ref_t key)
+{
+	hash_entry_t **link, *e;
+
+	_move_buckets(table, HASH_TABLE_MOVE_STEP);
+
+	link = _find_link(table, key, _hash(table, key));
+	if (!*link)
+		return 0;
+
+	e = *link;
+	*link = e->next;
+	--table->count;
+
+	release_ref(&e->key);
+	release_ref(&e->value);
+	X_FREE(e);
+	return 1;
+}
+
+void hash_table_iter_init(hash_table_iter_t *it, sl_hash_table_t *table)
+{
+	it->table = table;
+	it->in_old = 0;
+	it->bucket = 0;
+	it->entry = 0;
+}
+
+int hash_table_iter_next(hash_table_iter_t *it, ref_t *key, ref_t *value)
+{
+	sl_hash_table_t *table = it->table;
+
+	if (it->entry)
+		it->entry = it->entry->next;
+
+	while (!it->entry)
+	{
+		if (!it->in_old)
+		{
+			if (it->bucket > table->mask)
+			{
+				if (!table->old_buckets)
+					return 0;
+				it->in_old = 1;
+				it->bucket = table->moved;
+				continue;
+			}
+			it->entry = table->buckets[it->bucket++];
+		}
+		else
+		{
+			if (it->bucket > table->old_mask)
+				return 0;
+			it->entry = table->old_buckets[it->bucket++];
+		}
+	}
+
+	if (key)
+		*key = it->entry->key;
+	if (value)
+		*value = it->entry->value;
+	return 1;
+}
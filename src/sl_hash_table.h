@@ -0,0 +1,65 @@
+/* vim: set ts=4 sts=4 sw=4 noet ai: */
+#ifndef SL_HASH_TABLE_H
+#define SL_HASH_TABLE_H
+
+#include "gc.h"
+#include "ref.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct hash_entry_ts hash_entry_t;
+struct hash_entry_ts
+{
+	hash_entry_t *next;
+	size_t hash;
+	ref_t key;
+	ref_t value;
+};
+
+/* a hash table keyed by eq or eql.  it grows incrementally: when it fills up, a table
+   twice the size is allocated, and each later operation moves a few buckets of the old
+   table into it, so no single insert has to rehash everything */
+typedef struct sl_hash_table_ts
+{
+	gc_object_t gc;
+	int is_eql; /* 1 for an eql table, 0 for an eq table */
+	size_t count;
+	hash_entry_t **buckets;
+	size_t mask; /* the number of buckets - 1 */
+	hash_entry_t **old_buckets; /* the table being moved from while growing, or 0 */
+	size_t old_mask;
+	size_t moved; /* old buckets below this have already been moved */
+} sl_hash_table_t;
+
+/* walks the entries of a table.  the table mustn't change during the walk */
+typedef struct hash_table_iter_ts
+{
+	sl_hash_table_t *table;
+	int in_old;
+	size_t bucket;
+	hash_entry_t *entry;
+} hash_table_iter_t;
+
+/* returns a new, empty table */
+ref_t make_hash_table(int is_eql);
+
+/* returns the entry for key, or 0 if there isn't one */
+hash_entry_t *hash_table_find(sl_hash_table_t *table, ref_t key);
+
+/* sets the value for key, adding references to both */
+void hash_table_set(sl_hash_table_t *table, ref_t key, ref_t value);
+
+/* removes the entry for key; returns 0 if there wasn't one */
+int hash_table_remove(sl_hash_table_t *table, ref_t key);
+
+/* next returns 0 when there are no more entries; the key and value aren't cloned */
+void hash_table_iter_init(hash_table_iter_t *it, sl_hash_table_t *table);
+int hash_table_iter_next(hash_table_iter_t *it, ref_t *key, ref_t *value);
+
+#ifdef __cplusplus
+} /* end extern "C" */
+#endif
+
+#endif
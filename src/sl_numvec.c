@@ -0,0 +1,791 @@
+/* vim: set ts=4 sts=4 sw=4 noet ai: */
+#include "global.h"
+
+#include "smalisp.h"
+#include "gc.h"
+#include "sl_numvec.h"
+
+/* the x86 kernels are compiled for AVX/AVX2 with target attributes and only called
+   when the cpu reports those features, so the rest of the program doesn't need
+   building with -mavx */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define NUMVEC_X86 1
+#define AVX_FN __attribute__((target("avx")))
+#define AVX2_FN __attribute__((target("avx2")))
+#endif
+
+/* type traits */
+
+static void numvec_traits_gc_mark(ref_t instance)
+{
+	/* no refs to mark */
+}
+
+static void numvec_traits_gc_release_refs(ref_t instance)
+{
+	/* no refs to release */
+}
+
+static void numvec_traits_gc_free_mem(ref_t instance)
+{
+	sl_numvec_t *vec = (sl_numvec_t*)instance.data.object;
+	assert(vec);
+	X_FREE(vec->items.f64);
+	X_FREE(vec);
+}
+
+static void f64vector_traits_print(ref_t instance, FILE *to)
+{
+	sl_numvec_t *vec = (sl_numvec_t*)instance.data.object;
+	size_t n;
+
+	assert(vec);
+
+	fprintf(to, "#f64(");
+	for (n = 0; n != vec->size; ++n)
+		fprintf(to, n ? " %lf" : "%lf", vec->items.f64[n]);
+	fprintf(to, ")");
+}
+
+static void i64vector_traits_print(ref_t instance, FILE *to)
+{
+	sl_numvec_t *vec = (sl_numvec_t*)instance.data.object;
+	size_t n;
+
+	assert(vec);
+
+	fprintf(to, "#i64(");
+	for (n = 0; n != vec->size; ++n)
+		fprintf(to, n ? " %" PRId64 : "%" PRId64, vec->items.i64[n]);
+	fprintf(to, ")");
+}
+
+static ref_t f64vector_traits_type_name(ref_t instance)
+{
+	return make_symbol("f64vector", 0);
+}
+
+static ref_t i64vector_traits_type_name(ref_t instance)
+{
+	return make_symbol("i64vector", 0);
+}
+
+static int numvec_traits_eq(ref_t a, ref_t b)
+{
+	return a.data.object == b.data.object;
+}
+
+static int f64vector_traits_eql(ref_t a, ref_t b)
+{
+	sl_numvec_t *av = (sl_numvec_t*)a.data.object;
+	sl_numvec_t *bv = (sl_numvec_t*)b.data.object;
+	size_t n;
+
+	if (av->size != bv->size)
+		return 0;
+
+	for (n = 0; n != av->size; ++n)
+	{
+		if (av->items.f64[n] != bv->items.f64[n])
+			return 0;
+	}
+
+	return 1;
+}
+
+static int i64vector_traits_eql(ref_t a, ref_t b)
+{
+	sl_numvec_t *av = (sl_numvec_t*)a.data.object;
+	sl_numvec_t *bv = (sl_numvec_t*)b.data.object;
+
+	return av->size == bv->size && !memcmp(av->items.i64, bv->items.i64, av->size * sizeof(int64_t));
+}
+
+static size_t f64vector_traits_hash(ref_t instance)
+{
+	sl_numvec_t *vec = (sl_numvec_t*)instance.data.object;
+	size_t h = hash_mix(vec->size), n;
+	double d;
+	uint64_t bits;
+
+	for (n = 0; n != vec->size && n != HASH_MAX_ITEMS; ++n)
+	{
+		/* 0.0 and -0.0 compare equal, so they need the same hash */
+		d = vec->items.f64[n] == 0.0 ? 0.0 : vec->items.f64[n];
+		memcpy(&bits, &d, sizeof(bits));
+		h = hash_combine(h, hash_mix(bits));
+	}
+
+	return h;
+}
+
+static size_t i64vector_traits_hash(ref_t instance)
+{
+	sl_numvec_t *vec = (sl_numvec_t*)instance.data.object;
+	size_t h = hash_mix(vec->size), n;
+
+	for (n = 0; n != vec->size && n != HASH_MAX_ITEMS; ++n)
+		h = hash_combine(h, hash_mix((uint64_t)vec->items.i64[n]));
+
+	return h;
+}
+
+static const type_traits_t f64vector_traits =
+{
+	0, /* not evaluable */
+	0, /* not executable */
+	f64vector_traits_print,
+	f64vector_traits_type_name,
+	numvec_traits_eq,
+	f64vector_traits_eql,
+	f64vector_traits_hash,
+	gc_traits_addref,
+	gc_traits_release,
+	numvec_traits_gc_mark,
+	numvec_traits_gc_release_refs,
+	numvec_traits_gc_free_mem
+};
+const type_traits_t *f64vector_type = &f64vector_traits;
+
+static const type_traits_t i64vector_traits =
+{
+	0, /* not evaluable */
+	0, /* not executable */
+	i64vector_traits_print,
+	i64vector_traits_type_name,
+	numvec_traits_eq,
+	i64vector_traits_eql,
+	i64vector_traits_hash,
+	gc_traits_addref,
+	gc_traits_release,
+	numvec_traits_gc_mark,
+	numvec_traits_gc_release_refs,
+	numvec_traits_gc_free_mem
+};
+const type_traits_t *i64vector_type = &i64vector_traits;
+
+static sl_numvec_t *_alloc_numvec(const type_traits_t *type, size_t size, ref_t *ref)
+{
+	sl_numvec_t *vec;
+
+	vec = (sl_numvec_t*)X_MALLOC(sizeof(sl_numvec_t));
+	gc_init_object(&vec->gc, type);
+
+	/* both item types are 8 bytes; always allocate something so that items is never null */
+	vec->size = size;
+	vec->items.f64 = (double*)X_MALLOC((size ? size : 1) * sizeof(double));
+
+	ref->type = type;
+	ref->data.object = &vec->gc;
+	return vec;
+}
+
+ref_t make_f64vector(size_t size, double fill)
+{
+	ref_t ref;
+	sl_numvec_t *vec = _alloc_numvec(f64vector_type, size, &ref);
+	size_t n;
+
+	for (n = 0; n != size; ++n)
+		vec->items.f64[n] = fill;
+	return ref;
+}
+
+ref_t make_i64vector(size_t size, int64_t fill)
+{
+	ref_t ref;
+	sl_numvec_t *vec = _alloc_numvec(i64vector_type, size, &ref);
+	size_t n;
+
+	for (n = 0; n != size; ++n)
+		vec->items.i64[n] = fill;
+	return ref;
+}
+
+/* cpu feature checks; done once, on first use */
+
+#ifdef NUMVEC_X86
+static int have_avx = -1, have_avx2 = -1;
+
+static int _cpu_has_avx()
+{
+	if (have_avx < 0)
+	{
+		__builtin_cpu_init();
+		have_avx = __builtin_cpu_supports("avx") ? 1 : 0;
+	}
+	return have_avx;
+}
+
+static int _cpu_has_avx2()
+{
+	if (have_avx2 < 0)
+	{
+		__builtin_cpu_init();
+		have_avx2 = __builtin_cpu_supports("avx2") ? 1 : 0;
+	}
+	return have_avx2;
+}
+#endif
+
+/* f64 kernels */
+
+#ifdef NUMVEC_X86
+AVX_FN static double _f64_sum_avx(const double *x, size_t n)
+{
+	__m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd();
+	double lanes[4], sum;
+	size_t i = 0;
+
+	/* two accumulators, so that consecutive adds don't wait on each other */
+	for (; i + 8 <= n; i += 8)
+	{
+		s0 = _mm256_add_pd(s0, _mm256_loadu_pd(x + i));
+		s1 = _mm256_add_pd(s1, _mm256_loadu_pd(x + i + 4));
+	}
+	for (; i + 4 <= n; i += 4)
+		s0 = _mm256_add_pd(s0, _mm256_loadu_pd(x + i));
+
+	_mm256_storeu_pd(lanes, _mm256_add_pd(s0, s1));
+	sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+	for (; i < n; ++i)
+		sum += x[i];
+	return sum;
+}
+
+AVX_FN static double _f64_dot_avx(const double *x, const double *y, size_t n)
+{
+	__m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd();
+	double lanes[4], sum;
+	size_t i = 0;
+
+	for (; i + 8 <= n; i += 8)
+	{
+		s0 = _mm256_add_pd(s0, _mm256_mul_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i)));
+		s1 = _mm256_add_pd(s1, _mm256_mul_pd(_mm256_loadu_pd(x + i + 4), _mm256_loadu_pd(y + i + 4)));
+	}
+	for (; i + 4 <= n; i += 4)
+		s0 = _mm256_add_pd(s0, _mm256_mul_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i)));
+
+	_mm256_storeu_pd(lanes, _mm256_add_pd(s0, s1));
+	sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+	for (; i < n; ++i)
+		sum += x[i] * y[i];
+	return sum;
+}
+
+AVX_FN static void _f64_scale_avx(double *out, double a, const double *x, size_t n)
+{
+	__m256d av = _mm256_set1_pd(a);
+	size_t i = 0;
+
+	for (; i + 4 <= n; i += 4)
+		_mm256_storeu_pd(out + i, _mm256_mul_pd(av, _mm256_loadu_pd(x + i)));
+	for (; i < n; ++i)
+		out[i] = a * x[i];
+}
+
+AVX_FN static void _f64_axpy_avx(double *y, double a, const double *x, size_t n)
+{
+	__m256d av = _mm256_set1_pd(a);
+	size_t i = 0;
+
+	for (; i + 4 <= n; i += 4)
+		_mm256_storeu_pd(y + i, _mm256_add_pd(_mm256_mul_pd(av, _mm256_loadu_pd(x + i)), _mm256_loadu_pd(y + i)));
+	for (; i < n; ++i)
+		y[i] = a * x[i] + y[i];
+}
+
+AVX_FN static void _f64_add_avx(double *out, const double *x, const double *y, size_t n)
+{
+	size_t i = 0;
+
+	for (; i + 4 <= n; i += 4)
+		_mm256_storeu_pd(out + i, _mm256_add_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i)));
+	for (; i < n; ++i)
+		out[i] = x[i] + y[i];
+}
+
+AVX_FN static void _f64_mul_avx(double *out, const double *x, const double *y, size_t n)
+{
+	size_t i = 0;
+
+	for (; i + 4 <= n; i += 4)
+		_mm256_storeu_pd(out + i, _mm256_mul_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i)));
+	for (; i < n; ++i)
+		out[i] = x[i] * y[i];
+}
+
+/* returns the first NaN in x, which must have one */
+static double _f64_first_nan(const double *x, size_t n)
+{
+	size_t i;
+
+	for (i = 0; i != n; ++i)
+	{
+		if (x[i] != x[i])
+			break;
+	}
+	assert(i != n);
+	return x[i];
+}
+
+/* the vector min and max instructions give their second operand when either is a NaN,
+   so NaNs are looked for separately, and then found again in order, so that the result
+   is the same NaN that the plain loop would give */
+
+AVX_FN static double _f64_min_avx(const double *x, size_t n)
+{
+	__m256d m = _mm256_set1_pd(x[0]), nans = _mm256_setzero_pd(), v;
+	double lanes[4], result;
+	size_t i = 0;
+
+	for (; i + 4 <= n; i += 4)
+	{
+		v = _mm256_loadu_pd(x + i);
+		nans = _mm256_or_pd(nans, _mm256_cmp_pd(v, v, _CMP_UNORD_Q));
+		m = _mm256_min_pd(m, v);
+	}
+	if (_mm256_movemask_pd(nans))
+		return _f64_first_nan(x, n);
+
+	_mm256_storeu_pd(lanes, m);
+	result = lanes[0];
+	if (lanes[1] < result) result = lanes[1];
+	if (lanes[2] < result) result = lanes[2];
+	if (lanes[3] < result) result = lanes[3];
+	for (; i < n; ++i)
+	{
+		if (x[i] != x[i])
+			return x[i];
+		if (x[i] < result)
+			result = x[i];
+	}
+	return result;
+}
+
+AVX_FN static double _f64_max_avx(const double *x, size_t n)
+{
+	__m256d m = _mm256_set1_pd(x[0]), nans = _mm256_setzero_pd(), v;
+	double lanes[4], result;
+	size_t i = 0;
+
+	for (; i + 4 <= n; i += 4)
+	{
+		v = _mm256_loadu_pd(x + i);
+		nans = _mm256_or_pd(nans, _mm256_cmp_pd(v, v, _CMP_UNORD_Q));
+		m = _mm256_max_pd(m, v);
+	}
+	if (_mm256_movemask_pd(nans))
+		return _f64_first_nan(x, n);
+
+	_mm256_storeu_pd(lanes, m);
+	result = lanes[0];
+	if (lanes[1] > result) result = lanes[1];
+	if (lanes[2] > result) result = lanes[2];
+	if (lanes[3] > result) result = lanes[3];
+	for (; i < n; ++i)
+	{
+		if (x[i] != x[i])
+			return x[i];
+		if (x[i] > result)
+			result = x[i];
+	}
+	return result;
+}
+
+/* scans each block of four in two shifted adds, then adds the running total of the
+   blocks before it */
+AVX_FN static void _f64_prefix_sum_avx(double *out, const double *x, size_t n)
+{
+	__m256d carry = _mm256_setzero_pd(), v, t;
+	double sum;
+	size_t i = 0;
+
+	for (; i + 4 <= n; i += 4)
+	{
+		v = _mm256_loadu_pd(x + i);                       /* a b c d */
+		t = _mm256_permute2f128_pd(v, v, 0x08);           /* 0 0 a b */
+		v = _mm256_add_pd(v, _mm256_shuffle_pd(t, v, 0x4)); /* + 0 a b c */
+		v = _mm256_add_pd(v, _mm256_permute2f128_pd(v, v, 0x08)); /* + 0 0 a a+b */
+		v = _mm256_add_pd(v, carry);
+		_mm256_storeu_pd(out + i, v);
+		carry = _mm256_permute_pd(_mm256_permute2f128_pd(v, v, 0x11), 0xf);
+	}
+
+	sum = i ? out[i - 1] : 0.0;
+	for (; i < n; ++i)
+	{
+		sum += x[i];
+		out[i] = sum;
+	}
+}
+#endif
+
+double f64_sum(const double *x, size_t n)
+{
+	double sum = 0.0;
+	size_t i;
+
+#ifdef NUMVEC_X86
+	if (_cpu_has_avx())
+		return _f64_sum_avx(x, n);
+#endif
+
+	for (i = 0; i != n; ++i)
+		sum += x[i];
+	return sum;
+}
+
+double f64_dot(const double *x, const double *y, size_t n)
+{
+	double sum = 0.0;
+	size_t i;
+
+#ifdef NUMVEC_X86
+	if (_cpu_has_avx())
+		return _f64_dot_avx(x, y, n);
+#endif
+
+	for (i = 0; i != n; ++i)
+		sum += x[i] * y[i];
+	return sum;
+}
+
+void f64_scale(double *out, double a, const double *x, size_t n)
+{
+	size_t i;
+
+#ifdef NUMVEC_X86
+	if (_cpu_has_avx())
+	{
+		_f64_scale_avx(out, a, x, n);
+		return;
+	}
+#endif
+
+	for (i = 0; i != n; ++i)
+		out[i] = a * x[i];
+}
+
+void f64_axpy(double *y, double a, const double *x, size_t n)
+{
+	size_t i;
+
+#ifdef NUMVEC_X86
+	if (_cpu_has_avx())
+	{
+		_f64_axpy_avx(y, a, x, n);
+		return;
+	}
+#endif
+
+	for (i = 0; i != n; ++i)
+		y[i] = a * x[i] + y[i];
+}
+
+void f64_add(double *out, const double *x, const double *y, size_t n)
+{
+	size_t i;
+
+#ifdef NUMVEC_X86
+	if (_cpu_has_avx())
+	{
+		_f64_add_avx(out, x, y, n);
+		return;
+	}
+#endif
+
+	for (i = 0; i != n; ++i)
+		out[i] = x[i] + y[i];
+}
+
+void f64_mul(double *out, const double *x, const double *y, size_t n)
+{
+	size_t i;
+
+#ifdef NUMVEC_X86
+	if (_cpu_has_avx())
+	{
+		_f64_mul_avx(out, x, y, n);
+		return;
+	}
+#endif
+
+	for (i = 0; i != n; ++i)
+		out[i] = x[i] * y[i];
+}
+
+double f64_min(const double *x, size_t n)
+{
+	double result;
+	size_t i;
+
+	assert(n);
+
+#ifdef NUMVEC_X86
+	if (_cpu_has_avx())
+		return _f64_min_avx(x, n);
+#endif
+
+	result = x[0];
+	for (i = 0; i < n; ++i)
+	{
+		if (x[i] != x[i])
+			return x[i];
+		if (x[i] < result)
+			result = x[i];
+	}
+	return result;
+}
+
+double f64_max(const double *x, size_t n)
+{
+	double result;
+	size_t i;
+
+	assert(n);
+
+#ifdef NUMVEC_X86
+	if (_cpu_has_avx())
+		return _f64_max_avx(x, n);
+#endif
+
+	result = x[0];
+	for (i = 0; i < n; ++i)
+	{
+		if (x[i] != x[i])
+			return x[i];
+		if (x[i] > result)
+			result = x[i];
+	}
+	return result;
+}
+
+void f64_prefix_sum(double *out, const double *x, size_t n)
+{
+	double sum = 0.0;
+	size_t i;
+
+#ifdef NUMVEC_X86
+	if (_cpu_has_avx())
+	{
+		_f64_prefix_sum_avx(out, x, n);
+		return;
+	}
+#endif
+
+	for (i = 0; i != n; ++i)
+	{
+		sum += x[i];
+		out[i] = sum;
+	}
+}
+
+/* i64 kernels.  AVX2 has 64 bit adds and compares but no 64 bit multiply, so scale,
+   axpy, dot and mul are left as plain loops.  the arithmetic is done unsigned, so
+   that it wraps rather than overflowing */
+
+#ifdef NUMVEC_X86
+AVX2_FN static int64_t _i64_sum_avx2(const int64_t *x, size_t n)
+{
+	__m256i s = _mm256_setzero_si256();
+	int64_t lanes[4];
+	uint64_t sum;
+	size_t i = 0;
+
+	for (; i + 4 <= n; i += 4)
+		s = _mm256_add_epi64(s, _mm256_loadu_si256((const __m256i*)(x + i)));
+
+	_mm256_storeu_si256((__m256i*)lanes, s);
+	sum = (uint64_t)lanes[0] + (uint64_t)lanes[1] + (uint64_t)lanes[2] + (uint64_t)lanes[3];
+	for (; i < n; ++i)
+		sum += (uint64_t)x[i];
+	return (int64_t)sum;
+}
+
+AVX2_FN static void _i64_add_avx2(int64_t *out, const int64_t *x, const int64_t *y, size_t n)
+{
+	size_t i = 0;
+
+	for (; i + 4 <= n; i += 4)
+		_mm256_storeu_si256((__m256i*)(out + i), _mm256_add_epi64(
+			_mm256_loadu_si256((const __m256i*)(x + i)), _mm256_loadu_si256((const __m256i*)(y + i))));
+	for (; i < n; ++i)
+		out[i] = (int64_t)((uint64_t)x[i] + (uint64_t)y[i]);
+}
+
+AVX2_FN static int64_t _i64_min_avx2(const int64_t *x, size_t n)
+{
+	__m256i m = _mm256_set1_epi64x(x[0]), v;
+	int64_t lanes[4], result;
+	size_t i = 0;
+
+	for (; i + 4 <= n; i += 4)
+	{
+		v = _mm256_loadu_si256((const __m256i*)(x + i));
+		m = _mm256_blendv_epi8(m, v, _mm256_cmpgt_epi64(m, v));
+	}
+
+	_mm256_storeu_si256((__m256i*)lanes, m);
+	result = lanes[0];
+	if (lanes[1] < result) result = lanes[1];
+	if (lanes[2] < result) result = lanes[2];
+	if (lanes[3] < result) result = lanes[3];
+	for (; i < n; ++i)
+	{
+		if (x[i] < result)
+			result = x[i];
+	}
+	return result;
+}
+
+AVX2_FN static int64_t _i64_max_avx2(const int64_t *x, size_t n)
+{
+	__m256i m = _mm256_set1_epi64x(x[0]), v;
+	int64_t lanes[4], result;
+	size_t i = 0;
+
+	for (; i + 4 <= n; i += 4)
+	{
+		v = _mm256_loadu_si256((const __m256i*)(x + i));
+		m = _mm256_blendv_epi8(m, v, _mm256_cmpgt_epi64(v, m));
+	}
+
+	_mm256_storeu_si256((__m256i*)lanes, m);
+	result = lanes[0];
+	if (lanes[1] > result) result = lanes[1];
+	if (lanes[2] > result) result = lanes[2];
+	if (lanes[3] > result) result = lanes[3];
+	for (; i < n; ++i)
+	{
+		if (x[i] > result)
+			result = x[i];
+	}
+	return result;
+}
+#endif
+
+int64_t i64_sum(const int64_t *x, size_t n)
+{
+	uint64_t sum = 0;
+	size_t i;
+
+#ifdef NUMVEC_X86
+	if (_cpu_has_avx2())
+		return _i64_sum_avx2(x, n);
+#endif
+
+	for (i = 0; i != n; ++i)
+		sum += (uint64_t)x[i];
+	return (int64_t)sum;
+}
+
+int64_t i64_dot(const int64_t *x, const int64_t *y, size_t n)
+{
+	uint64_t sum = 0;
+	size_t i;
+
+	for (i = 0; i != n; ++i)
+		sum += (uint64_t)x[i] * (uint64_t)y[i];
+	return (int64_t)sum;
+}
+
+void i64_scale(int64_t *out, int64_t a, const int64_t *x, size_t n)
+{
+	size_t i;
+
+	for (i = 0; i != n; ++i)
+		out[i] = (int64_t)((uint64_t)a * (uint64_t)x[i]);
+}
+
+void i64_axpy(int64_t *y, int64_t a, const int64_t *x, size_t n)
+{
+	size_t i;
+
+	for (i = 0; i != n; ++i)
+		y[i] = (int64_t)((uint64_t)a * (uint64_t)x[i] + (uint64_t)y[i]);
+}
+
+void i64_add(int64_t *out, const int64_t *x, const int64_t *y, size_t n)
+{
+	size_t i;
+
+#ifdef NUMVEC_X86
+	if (_cpu_has_avx2())
+	{
+		_i64_add_avx2(out, x, y, n);
+		return;
+	}
+#endif
+
+	for (i = 0; i != n; ++i)
+		out[i] = (int64_t)((uint64_t)x[i] + (uint64_t)y[i]);
+}
+
+void i64_mul(int64_t *out, const int64_t *x, const int64_t *y, size_t n)
+{
+	size_t i;
+
+	for (i = 0; i != n; ++i)
+		out[i] = (int64_t)((uint64_t)x[i] * (uint64_t)y[i]);
+}
+
+int64_t i64_min(const int64_t *x, size_t n)
+{
+	int64_t result;
+	size_t i;
+
+	assert(n);
+
+#ifdef NUMVEC_X86
+	if (_cpu_has_avx2())
+		return _i64_min_avx2(x, n);
+#endif
+
+	result = x[0];
+	for (i = 0; i < n; ++i)
+	{
+		if (x[i] != x[i])
+			return x[i];
+		if (x[i] < result)
+			result = x[i];
+	}
+	return result;
+}
+
+int64_t i64_max(const int64_t *x, size_t n)
+{
+	int64_t result;
+	size_t i;
+
+	assert(n);
+
+#ifdef NUMVEC_X86
+	if (_cpu_has_avx2())
+		return _i64_max_avx2(x, n);
+#endif
+
+	result = x[0];
+	for (i = 0; i < n; ++i)
+	{
+		if (x[i] != x[i])
+			return x[i];
+		if (x[i] > result)
+			result = x[i];
+	}
+	return result;
+}
+
+void i64_prefix_sum(int64_t *out, const int64_t *x, size_t n)
+{
+	uint64_t sum = 0;
+	size_t i;
+
+	for (i = 0; i != n; ++i)
+	{
+		sum += (uint64_t)x[i];
+		out[i] = (int64_t)sum;
+	}
+}
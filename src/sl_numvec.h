@@ -0,0 +1,56 @@
+/* vim: set ts=4 sts=4 sw=4 noet ai: */
+#ifndef SL_NUMVEC_H
+#define SL_NUMVEC_H
+
+#include "gc.h"
+#include "ref.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* an f64vector or i64vector: a garbage collected array of unboxed numbers */
+typedef struct sl_numvec_ts
+{
+	gc_object_t gc;
+	size_t size;
+	union
+	{
+		double *f64;
+		int64_t *i64;
+	} items;
+} sl_numvec_t;
+
+/* return vectors of size items, each set to fill */
+ref_t make_f64vector(size_t size, double fill);
+ref_t make_i64vector(size_t size, int64_t fill);
+
+/* bulk kernels.  the f64 ones use AVX when the cpu has it, so sums and dot products
+   may round differently from a left to right loop.  the i64 ones wrap on overflow,
+   since the results have nowhere to be promoted to */
+double f64_sum(const double *x, size_t n);
+double f64_dot(const double *x, const double *y, size_t n);
+void f64_scale(double *out, double a, const double *x, size_t n); /* out = a*x */
+void f64_axpy(double *y, double a, const double *x, size_t n); /* y = a*x + y */
+void f64_add(double *out, const double *x, const double *y, size_t n);
+void f64_mul(double *out, const double *x, const double *y, size_t n);
+/* n must be at least 1.  a NaN anywhere in x is the result (the first one, if there are several) */
+double f64_min(const double *x, size_t n);
+double f64_max(const double *x, size_t n);
+void f64_prefix_sum(double *out, const double *x, size_t n);
+
+int64_t i64_sum(const int64_t *x, size_t n);
+int64_t i64_dot(const int64_t *x, const int64_t *y, size_t n);
+void i64_scale(int64_t *out, int64_t a, const int64_t *x, size_t n);
+void i64_axpy(int64_t *y, int64_t a, const int64_t *x, size_t n);
+void i64_add(int64_t *out, const int64_t *x, const int64_t *y, size_t n);
+void i64_mul(int64_t *out, const int64_t *x, const int64_t *y, size_t n);
+int64_t i64_min(const int64_t *x, size_t n); /* n must be at least 1 */
+int64_t i64_max(const int64_t *x, size_t n); /* n must be at least 1 */
+void i64_prefix_sum(int64_t *out, const int64_t *x, size_t n);
+
+#ifdef __cplusplus
+} /* end extern "C" */
+#endif
+
+#endif
@@ -0,0 +1,581 @@
+/* vim: set ts=4 sts=4 sw=4 noet ai: */
+#include "global.h"
+
+#include <stddef.h>
+
+#include "smalisp.h"
+#include "gc.h"
+#include "sl_pmap.h"
+
+#define PMAP_NODE(ref) ((pmap_node_t*)(ref).data.object)
+/* the number of refs a node holds */
+#define PMAP_NODE_REFS(node) (2 * (node)->num_entries + (node)->num_nodes)
+
+static unsigned _popcount(uint32_t x)
+{
+#ifdef __GNUC__
+	return (unsigned)__builtin_popcount(x);
+#else
+	unsigned n = 0;
+	for (; x; x &= x - 1)
+		++n;
+	return n;
+#endif
+}
+
+/* the bit for hash's slot in a node at shift */
+static uint32_t _bit(size_t hash, unsigned shift)
+{
+	return (uint32_t)1 << ((hash >> shift) & PMAP_MASK);
+}
+
+/* the index of bit's slot among the slots in map */
+static size_t _index(uint32_t map, uint32_t bit)
+{
+	return _popcount(map & (bit - 1));
+}
+
+/* nodes */
+
+static void pmap_node_traits_print(ref_t instance, FILE *to)
+{
+	fprintf(to, "#<pmap-node>");
+}
+
+static int pmap_node_traits_eq(ref_t a, ref_t b)
+{
+	return a.data.object == b.data.object;
+}
+
+static void pmap_node_traits_gc_mark(ref_t instance)
+{
+	pmap_node_t *node = (pmap_node_t*)instance.data.object;
+	size_t n;
+
+	for (n = 0; n != PMAP_NODE_REFS(node); ++n)
+		ref_gc_mark(node->refs[n]);
+}
+
+static void pmap_node_traits_gc_release_refs(ref_t instance)
+{
+	pmap_node_t *node = (pmap_node_t*)instance.data.object;
+	size_t n;
+
+	for (n = 0; n != PMAP_NODE_REFS(node); ++n)
+		release_ref(&node->refs[n]);
+}
+
+static void pmap_node_traits_gc_free_mem(ref_t instance)
+{
+	pmap_node_t *node = (pmap_node_t*)instance.data.object;
+	X_FREE(node);
+}
+
+static const type_traits_t pmap_node_traits =
+{
+	0, /* not evaluable */
+	0, /* not executable */
+	pmap_node_traits_print,
+	0, /* no type name (hidden type) */
+	pmap_node_traits_eq,
+	pmap_node_traits_eq, /* eq and eql do the same thing for nodes */
+	0, /* no hash (hidden type) */
+	gc_traits_addref,
+	gc_traits_release,
+	pmap_node_traits_gc_mark,
+	pmap_node_traits_gc_release_refs,
+	pmap_node_traits_gc_free_mem
+};
+const type_traits_t *pmap_node_type = &pmap_node_traits;
+
+/* returns a new node of the given shape; the caller fills in its refs */
+static ref_t _alloc_node(uint32_t datamap, uint32_t nodemap, size_t num_entries, size_t num_nodes)
+{
+	ref_t ref;
+	pmap_node_t *node;
+
+	node = (pmap_node_t*)X_MALLOC(offsetof(pmap_node_t, refs) + (2 * num_entries + num_nodes) * sizeof(ref_t));
+	gc_init_object(&node->gc, pmap_node_type);
+
+	node->datamap = datamap;
+	node->nodemap = nodemap;
+	node->num_entries = num_entries;
+	node->num_nodes = num_nodes;
+
+	ref.type = pmap_node_type;
+	ref.data.object = &node->gc;
+	return ref;
+}
+
+/* returns the node in *slot, ready to be changed: the node itself if nothing else refers
+   to it, or else a copy, which takes its place in *slot */
+static pmap_node_t *_editable(ref_t *slot)
+{
+	pmap_node_t *node = PMAP_NODE(*slot);
+	ref_t copy;
+	size_t n;
+
+	if (node->gc.rc == 1)
+		return node;
+
+	copy = _alloc_node(node->datamap, node->nodemap, node->num_entries, node->num_nodes);
+	for (n = 0; n != PMAP_NODE_REFS(node); ++n)
+		PMAP_NODE(copy)->refs[n] = clone_ref(node->refs[n]);
+	release_ref(slot);
+	*slot = copy;
+
+	return PMAP_NODE(copy);
+}
+
+/* replaces the node in *slot with one of the given shape.  its refs are the old node's,
+   with num_del of them taken out from del, and then the num_ins refs of ins (which it
+   takes over) put in at ins_at.  the old refs are moved rather than copied when nothing
+   else refers to the old node */
+static void _resplice(ref_t *slot, uint32_t datamap, uint32_t nodemap, size_t num_entries, size_t num_nodes,
+	size_t del, size_t num_del, size_t ins_at, const ref_t *ins, size_t num_ins)
+{
+	pmap_node_t *old = PMAP_NODE(*slot), *node;
+	int move = old->gc.rc == 1;
+	ref_t ref;
+	size_t n, from;
+
+	ref = _alloc_node(datamap, nodemap, num_entries, num_nodes);
+	node = PMAP_NODE(ref);
+	assert(PMAP_NODE_REFS(node) == PMAP_NODE_REFS(old) - num_del + num_ins);
+
+	for (n = 0; n != PMAP_NODE_REFS(node); ++n)
+	{
+		if (n >= ins_at && n < ins_at + num_ins)
+		{
+			node->refs[n] = ins[n - ins_at];
+			continue;
+		}
+
+		from = (n < ins_at) ? n : n - num_ins;
+		if (from >= del)
+			from += num_del;
+
+		if (move)
+		{
+			node->refs[n] = old->refs[from];
+			old->refs[from] = nil();
+		}
+		else
+			node->refs[n] = clone_ref(old->refs[from]);
+	}
+
+	release_ref(slot);
+	*slot = ref;
+}
+
+/* sets the value of entry n of the node in *slot */
+static void _set_value(ref_t *slot, size_t n, ref_t value)
+{
+	pmap_node_t *node = _editable(slot);
+	ref_t old = node->refs[2 * n + 1];
+
+	node->refs[2 * n + 1] = clone_ref(value);
+	release_ref(&old);
+}
+
+/* sets key's value in the trie below *slot, a node at shift; returns 1 if key is new */
+static int _set(ref_t *slot, unsigned shift, ref_t key, size_t hash, ref_t value)
+{
+	pmap_node_t *node;
+	ref_t entry[2], child;
+	size_t n, num_entries, num_nodes;
+	uint32_t bit;
+
+	entry[0] = key;
+	entry[1] = value;
+
+	if (slot->type == NIL)
+	{
+		*slot = _alloc_node(shift < PMAP_COLLISION_SHIFT ? _bit(hash, shift) : 0, 0, 1, 0);
+		PMAP_NODE(*slot)->refs[0] = clone_ref(key);
+		PMAP_NODE(*slot)->refs[1] = clone_ref(value);
+		return 1;
+	}
+
+	node = PMAP_NODE(*slot);
+	num_entries = node->num_entries;
+	num_nodes = node->num_nodes;
+
+	if (shift >= PMAP_COLLISION_SHIFT)
+	{
+		for (n = 0; n != num_entries; ++n)
+		{
+			if (eql(node->refs[2 * n], key))
+			{
+				_set_value(slot, n, value);
+				return 0;
+			}
+		}
+
+		entry[0] = clone_ref(key);
+		entry[1] = clone_ref(value);
+		_resplice(slot, 0, 0, num_entries + 1, 0, 0, 0, 2 * num_entries, entry, 2);
+		return 1;
+	}
+
+	bit = _bit(hash, shift);
+
+	if (node->datamap & bit)
+	{
+		n = _index(node->datamap, bit);
+		if (eql(node->refs[2 * n], key))
+		{
+			_set_value(slot, n, value);
+			return 0;
+		}
+
+		/* the entry already in the slot and the new one go into a new child together */
+		child = nil();
+		_set(&child, shift + PMAP_BITS, node->refs[2 * n], hash_eql(node->refs[2 * n]), node->refs[2 * n + 1]);
+		_set(&child, shift + PMAP_BITS, key, hash, value);
+		_resplice(slot, node->datamap & ~bit, node->nodemap | bit, num_entries - 1, num_nodes + 1,
+			2 * n, 2, 2 * (num_entries - 1) + _index(node->nodemap, bit), &child, 1);
+		return 1;
+	}
+
+	if (node->nodemap & bit)
+	{
+		n = 2 * num_entries + _index(node->nodemap, bit);
+		return _set(&_editable(slot)->refs[n], shift + PMAP_BITS, key, hash, value);
+	}
+
+	entry[0] = clone_ref(key);
+	entry[1] = clone_ref(value);
+	_resplice(slot, node->datamap | bit, node->nodemap, num_entries + 1, num_nodes,
+		0, 0, 2 * _index(node->datamap, bit), entry, 2);
+	return 1;
+}
+
+/* removes key, which must be there, from the trie below *slot, a node at shift */
+static void _remove(ref_t *slot, unsigned shift, ref_t key, size_t hash)
+{
+	pmap_node_t *node = PMAP_NODE(*slot), *child;
+	ref_t entry[2];
+	size_t n, c, num_entries = node->num_entries, num_nodes = node->num_nodes;
+	uint32_t bit;
+
+	/* only a root can get down to one entry */
+	if (num_entries == 1 && num_nodes == 0)
+	{
+		release_ref(slot);
+		return;
+	}
+
+	if (shift >= PMAP_COLLISION_SHIFT)
+	{
+		for (n = 0; !eql(node->refs[2 * n], key); ++n)
+			;
+		_resplice(slot, 0, 0, num_entries - 1, 0, 2 * n, 2, 0, 0, 0);
+		return;
+	}
+
+	bit = _bit(hash, shift);
+
+	if (node->datamap & bit)
+	{
+		_resplice(slot, node->datamap & ~bit, node->nodemap, num_entries - 1, num_nodes,
+			2 * _index(node->datamap, bit), 2, 0, 0, 0);
+		return;
+	}
+
+	c = 2 * num_entries + _index(node->nodemap, bit);
+	node = _editable(slot);
+	_remove(&node->refs[c], shift + PMAP_BITS, key, hash);
+
+	/* a child left with a single entry hands it back to this node */
+	child = PMAP_NODE(node->refs[c]);
+	if (child->num_entries == 1 && child->num_nodes == 0)
+	{
+		entry[0] = clone_ref(child->refs[0]);
+		entry[1] = clone_ref(child->refs[1]);
+		_resplice(slot, node->datamap | bit, node->nodemap & ~bit, num_entries + 1, num_nodes - 1,
+			c, 1, 2 * _index(node->datamap, bit), entry, 2);
+	}
+}
+
+static void _for_each(pmap_node_t *node, void (*fn)(ref_t key, ref_t value, void *data), void *data)
+{
+	size_t n;
+
+	for (n = 0; n != node->num_entries; ++n)
+		fn(node->refs[2 * n], node->refs[2 * n + 1], data);
+	for (n = 0; n != node->num_nodes; ++n)
+		_for_each(PMAP_NODE(node->refs[2 * node->num_entries + n]), fn, data);
+}
+
+/* maps */
+
+static void _print_node(pmap_node_t *node, FILE *to, int *first)
+{
+	size_t n;
+
+	for (n = 0; n != node->num_entries; ++n)
+	{
+		if (!*first)
+			fprintf(to, " ");
+		*first = 0;
+		print(node->refs[2 * n], to);
+		fprintf(to, " ");
+		print(node->refs[2 * n + 1], to);
+	}
+	for (n = 0; n != node->num_nodes; ++n)
+		_print_node(PMAP_NODE(node->refs[2 * node->num_entries + n]), to, first);
+}
+
+static void pmap_traits_print(ref_t instance, FILE *to)
+{
+	sl_pmap_t *map = (sl_pmap_t*)instance.data.object;
+	int first = 1;
+
+	if (map->state != PMAP_PERSISTENT)
+	{
+		fprintf(to, "#<transient-pmap %lu>", (unsigned long)map->count);
+		return;
+	}
+
+	if (map->gc.flags & GC_FLAG_PRINTING)
+	{
+		fprintf(to, "#pmap(...)");
+		return;
+	}
+	map->gc.flags |= GC_FLAG_PRINTING;
+
+	fprintf(to, "#pmap(");
+	if (map->root.type != NIL)
+		_print_node(PMAP_NODE(map->root), to, &first);
+	fprintf(to, ")");
+
+	map->gc.flags &= ~GC_FLAG_PRINTING;
+}
+
+static ref_t pmap_traits_type_name(ref_t instance)
+{
+	if (((sl_pmap_t*)instance.data.object)->state != PMAP_PERSISTENT)
+		return make_symbol("transient-pmap", 0);
+	return make_symbol("pmap", 0);
+}
+
+static int pmap_traits_eq(ref_t a, ref_t b)
+{
+	return a.data.object == b.data.object;
+}
+
+/* the trie's shape only depends on its keys, so equal maps have entries in the same
+   places, and shared nodes needn't be looked at.  collision nodes can hold their entries
+   in any order, so those are compared by looking each entry up */
+static int _nodes_eql(pmap_node_t *a, pmap_node_t *b)
+{
+	size_t n, m;
+
+	if (a == b)
+		return 1;
+
+	if (a->datamap != b->datamap || a->nodemap != b->nodemap ||
+		a->num_entries != b->num_entries || a->num_nodes != b->num_nodes)
+		return 0;
+
+	if (!a->datamap && !a->nodemap)
+	{
+		for (n = 0; n != a->num_entries; ++n)
+		{
+			for (m = 0; m != b->num_entries && !eql(a->refs[2 * n], b->refs[2 * m]); ++m)
+				;
+			if (m == b->num_entries || !eql(a->refs[2 * n + 1], b->refs[2 * m + 1]))
+				return 0;
+		}
+		return 1;
+	}
+
+	for (n = 0; n != 2 * a->num_entries; ++n)
+	{
+		if (!eql(a->refs[n], b->refs[n]))
+			return 0;
+	}
+	for (n = 0; n != a->num_nodes; ++n)
+	{
+		if (!_nodes_eql(PMAP_NODE(a->refs[2 * a->num_entries + n]), PMAP_NODE(b->refs[2 * b->num_entries + n])))
+			return 0;
+	}
+
+	return 1;
+}
+
+static int pmap_traits_eql(ref_t a, ref_t b)
+{
+	sl_pmap_t *am = (sl_pmap_t*)a.data.object;
+	sl_pmap_t *bm = (sl_pmap_t*)b.data.object;
+
+	if (am->count != bm->count)
+		return 0;
+	if (!am->count)
+		return 1;
+	return _nodes_eql(PMAP_NODE(am->root), PMAP_NODE(bm->root));
+}
+
+/* hashes entries in trie order until *left runs out, skipping collision nodes, whose
+   order isn't fixed */
+static size_t _hash_node(pmap_node_t *node, size_t h, size_t *left)
+{
+	size_t n;
+
+	if (!node->datamap && !node->nodemap)
+		return h;
+
+	for (n = 0; n != node->num_entries && *left; ++n, --*left)
+	{
+		h = hash_combine(h, hash_eql(node->refs[2 * n]));
+		h = hash_combine(h, hash_eql(node->refs[2 * n + 1]));
+	}
+	for (n = 0; n != node->num_nodes && *left; ++n)
+		h = _hash_node(PMAP_NODE(node->refs[2 * node->num_entries + n]), h, left);
+
+	return h;
+}
+
+static size_t pmap_traits_hash(ref_t instance)
+{
+	sl_pmap_t *map = (sl_pmap_t*)instance.data.object;
+	size_t h = hash_mix(map->count), left = HASH_MAX_ITEMS;
+
+	if (map->root.type != NIL)
+		h = _hash_node(PMAP_NODE(map->root), h, &left);
+	return h;
+}
+
+static void pmap_traits_gc_mark(ref_t instance)
+{
+	ref_gc_mark(((sl_pmap_t*)instance.data.object)->root);
+}
+
+static void pmap_traits_gc_release_refs(ref_t instance)
+{
+	release_ref(&((sl_pmap_t*)instance.data.object)->root);
+}
+
+static void pmap_traits_gc_free_mem(ref_t instance)
+{
+	sl_pmap_t *map = (sl_pmap_t*)instance.data.object;
+	X_FREE(map);
+}
+
+static const type_traits_t pmap_traits =
+{
+	0, /* not evaluable */
+	0, /* not executable */
+	pmap_traits_print,
+	pmap_traits_type_name,
+	pmap_traits_eq,
+	pmap_traits_eql,
+	pmap_traits_hash,
+	gc_traits_addref,
+	gc_traits_release,
+	pmap_traits_gc_mark,
+	pmap_traits_gc_release_refs,
+	pmap_traits_gc_free_mem
+};
+const type_traits_t *pmap_type = &pmap_traits;
+
+static sl_pmap_t *_alloc_pmap(int state)
+{
+	sl_pmap_t *map;
+
+	map = (sl_pmap_t*)X_MALLOC(sizeof(sl_pmap_t));
+	gc_init_object(&map->gc, pmap_type);
+
+	map->root = nil();
+	map->count = 0;
+	map->state = state;
+	return map;
+}
+
+ref_t make_pmap()
+{
+	ref_t ref;
+
+	ref.type = pmap_type;
+	ref.data.object = &_alloc_pmap(PMAP_PERSISTENT)->gc;
+	return ref;
+}
+
+ref_t pmap_copy(sl_pmap_t *map, int state)
+{
+	ref_t ref;
+	sl_pmap_t *copy;
+
+	copy = _alloc_pmap(state);
+	copy->root = clone_ref(map->root);
+	copy->count = map->count;
+
+	ref.type = pmap_type;
+	ref.data.object = &copy->gc;
+	return ref;
+}
+
+ref_t *pmap_find(sl_pmap_t *map, ref_t key)
+{
+	size_t hash, n;
+	pmap_node_t *node;
+	unsigned shift;
+	uint32_t bit;
+
+	if (map->root.type == NIL)
+		return 0;
+
+	hash = hash_eql(key);
+	node = PMAP_NODE(map->root);
+	for (shift = 0; shift < PMAP_COLLISION_SHIFT; shift += PMAP_BITS)
+	{
+		bit = _bit(hash, shift);
+		if (node->datamap & bit)
+		{
+			n = 2 * _index(node->datamap, bit);
+			return eql(node->refs[n], key) ? &node->refs[n + 1] : 0;
+		}
+		if (!(node->nodemap & bit))
+			return 0;
+		node = PMAP_NODE(node->refs[2 * node->num_entries + _index(node->nodemap, bit)]);
+	}
+
+	for (n = 0; n != node->num_entries; ++n)
+	{
+		if (eql(node->refs[2 * n], key))
+			return &node->refs[2 * n + 1];
+	}
+	return 0;
+}
+
+void pmap_set(sl_pmap_t *map, ref_t key, ref_t value)
+{
+	assert(map->state != PMAP_FINISHED);
+	map->count += _set(&map->root, 0, key, hash_eql(key), value);
+}
+
+int pmap_remove(sl_pmap_t *map, ref_t key)
+{
+	assert(map->state != PMAP_FINISHED);
+
+	if (!pmap_find(map, key))
+		return 0;
+
+	_remove(&map->root, 0, key, hash_eql(key));
+	--map->count;
+	return 1;
+}
+
+void pmap_for_each(sl_pmap_t *map, void (*fn)(ref_t key, ref_t value, void *data), void *data)
+{
+	if (map->root.type != NIL)
+		_for_each(PMAP_NODE(map->root), fn, data);
+}
+
+void pmap_finish(sl_pmap_t *map)
+{
+	release_ref(&map->root);
+	map->count = 0;
+	map->state = PMAP_FINISHED;
+}
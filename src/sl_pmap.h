@@ -0,0 +1,73 @@
+/* vim: set ts=4 sts=4 sw=4 noet ai: */
+#ifndef SL_PMAP_H
+#define SL_PMAP_H
+
+#include "gc.h"
+#include "ref.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PMAP_BITS (5)
+#define PMAP_MASK ((1 << PMAP_BITS) - 1)
+/* nodes this deep have used up the whole hash, and hold colliding keys in a plain list */
+#define PMAP_COLLISION_SHIFT (sizeof(size_t) * 8)
+
+/* a node of a persistent map's hash array mapped trie.  each level looks at the next
+   PMAP_BITS bits of a key's hash; a slot holds nothing, an entry, or a child node for the
+   next level, and only the slots in use take up room.  a child always holds at least
+   two entries between it and its children, so each set of keys has exactly one shape of
+   trie.  collision nodes have no maps, and hold all their entries in order */
+typedef struct pmap_node_ts
+{
+	gc_object_t gc;
+	uint32_t datamap; /* a bit for each slot holding an entry */
+	uint32_t nodemap; /* a bit for each slot holding a child */
+	size_t num_entries;
+	size_t num_nodes;
+	ref_t refs[1]; /* the key and value of each entry, then the children */
+} pmap_node_t;
+
+/* the states of a pmap */
+#define PMAP_PERSISTENT (0)
+#define PMAP_TRANSIENT (1)
+#define PMAP_FINISHED (2) /* a transient that persistent! has been called on */
+
+/* a persistent map, with keys compared by eql.  versions of a map share nodes; a node is
+   only changed in place when nothing else refers to it, and is copied otherwise, so a
+   map made from another by pmap_copy only copies the nodes on the paths it changes */
+typedef struct sl_pmap_ts
+{
+	gc_object_t gc;
+	ref_t root; /* a node, or nil when the map is empty */
+	size_t count;
+	int state;
+} sl_pmap_t;
+
+/* returns a new, empty, persistent map */
+ref_t make_pmap();
+
+/* returns a new map with map's entries, sharing its nodes; state is PMAP_PERSISTENT or
+   PMAP_TRANSIENT */
+ref_t pmap_copy(sl_pmap_t *map, int state);
+
+/* returns the value for key, or 0 if there isn't one */
+ref_t *pmap_find(sl_pmap_t *map, ref_t key);
+
+/* these change map itself, so for a persistent map they must only be used on a new one
+   from pmap_copy that nothing else has seen yet */
+void pmap_set(sl_pmap_t *map, ref_t key, ref_t value);
+int pmap_remove(sl_pmap_t *map, ref_t key); /* returns 0 if there was no entry for key */
+
+/* calls fn on the key and value of every entry */
+void pmap_for_each(sl_pmap_t *map, void (*fn)(ref_t key, ref_t value, void *data), void *data);
+
+/* drops a transient's entries and marks it PMAP_FINISHED */
+void pmap_finish(sl_pmap_t *map);
+
+#ifdef __cplusplus
+} /* end extern "C" */
+#endif
+
+#endif
@@ -0,0 +1,395 @@
+/* vim: set ts=4 sts=4 sw=4 noet ai: */
+#include "global.h"
+
+#include "smalisp.h"
+#include "gc.h"
+#include "sl_pvec.h"
+
+#define PVEC_NODE(ref) ((pvec_node_t*)(ref).data.object)
+
+/* nodes */
+
+static void pvec_node_traits_print(ref_t instance, FILE *to)
+{
+	fprintf(to, "#<pvec-node>");
+}
+
+static int pvec_node_traits_eq(ref_t a, ref_t b)
+{
+	return a.data.object == b.data.object;
+}
+
+static void pvec_node_traits_gc_mark(ref_t instance)
+{
+	pvec_node_t *node = (pvec_node_t*)instance.data.object;
+	size_t n;
+
+	for (n = 0; n != PVEC_WIDTH; ++n)
+		ref_gc_mark(node->items[n]);
+}
+
+static void pvec_node_traits_gc_release_refs(ref_t instance)
+{
+	pvec_node_t *node = (pvec_node_t*)instance.data.object;
+	size_t n;
+
+	for (n = 0; n != PVEC_WIDTH; ++n)
+		release_ref(&node->items[n]);
+}
+
+static void pvec_node_traits_gc_free_mem(ref_t instance)
+{
+	pvec_node_t *node = (pvec_node_t*)instance.data.object;
+	X_FREE(node);
+}
+
+static const type_traits_t pvec_node_traits =
+{
+	0, /* not evaluable */
+	0, /* not executable */
+	pvec_node_traits_print,
+	0, /* no type name (hidden type) */
+	pvec_node_traits_eq,
+	pvec_node_traits_eq, /* eq and eql do the same thing for nodes */
+	0, /* no hash (hidden type) */
+	gc_traits_addref,
+	gc_traits_release,
+	pvec_node_traits_gc_mark,
+	pvec_node_traits_gc_release_refs,
+	pvec_node_traits_gc_free_mem
+};
+const type_traits_t *pvec_node_type = &pvec_node_traits;
+
+static ref_t _new_node()
+{
+	ref_t ref;
+	pvec_node_t *node;
+	size_t n;
+
+	node = (pvec_node_t*)X_MALLOC(sizeof(pvec_node_t));
+	gc_init_object(&node->gc, pvec_node_type);
+
+	for (n = 0; n != PVEC_WIDTH; ++n)
+		node->items[n] = nil();
+
+	ref.type = pvec_node_type;
+	ref.data.object = &node->gc;
+	return ref;
+}
+
+/* returns the node in *slot, ready to be changed: the node itself if nothing else refers
+   to it, or else a copy, which takes its place in *slot.  an empty slot gets a new node */
+static pvec_node_t *_editable(ref_t *slot)
+{
+	ref_t copy;
+	size_t n;
+
+	if (slot->type == NIL)
+		*slot = _new_node();
+	else if (PVEC_NODE(*slot)->gc.rc != 1)
+	{
+		copy = _new_node();
+		for (n = 0; n != PVEC_WIDTH; ++n)
+			PVEC_NODE(copy)->items[n] = clone_ref(PVEC_NODE(*slot)->items[n]);
+		release_ref(slot);
+		*slot = copy;
+	}
+
+	return PVEC_NODE(*slot);
+}
+
+/* vectors */
+
+static void pvec_traits_print(ref_t instance, FILE *to)
+{
+	sl_pvec_t *vec = (sl_pvec_t*)instance.data.object;
+	size_t n;
+
+	if (vec->state != PVEC_PERSISTENT)
+	{
+		fprintf(to, "#<transient-pvec %lu>", (unsigned long)vec->count);
+		return;
+	}
+
+	if (vec->gc.flags & GC_FLAG_PRINTING)
+	{
+		fprintf(to, "#pvec(...)");
+		return;
+	}
+	vec->gc.flags |= GC_FLAG_PRINTING;
+
+	fprintf(to, "#pvec(");
+	for (n = 0; n != vec->count; ++n)
+	{
+		if (n)
+			fprintf(to, " ");
+		print(pvec_nth(vec, n), to);
+	}
+	fprintf(to, ")");
+
+	vec->gc.flags &= ~GC_FLAG_PRINTING;
+}
+
+static ref_t pvec_traits_type_name(ref_t instance)
+{
+	if (((sl_pvec_t*)instance.data.object)->state != PVEC_PERSISTENT)
+		return make_symbol("transient-pvec", 0);
+	return make_symbol("pvec", 0);
+}
+
+static int pvec_traits_eq(ref_t a, ref_t b)
+{
+	return a.data.object == b.data.object;
+}
+
+static int pvec_traits_eql(ref_t a, ref_t b)
+{
+	sl_pvec_t *av = (sl_pvec_t*)a.data.object;
+	sl_pvec_t *bv = (sl_pvec_t*)b.data.object;
+	size_t n;
+
+	if (av->count != bv->count)
+		return 0;
+
+	for (n = 0; n != av->count; ++n)
+	{
+		if (!eql(pvec_nth(av, n), pvec_nth(bv, n)))
+			return 0;
+	}
+
+	return 1;
+}
+
+static size_t pvec_traits_hash(ref_t instance)
+{
+	sl_pvec_t *vec = (sl_pvec_t*)instance.data.object;
+	size_t h = hash_mix(vec->count), n;
+
+	for (n = 0; n != vec->count && n != HASH_MAX_ITEMS; ++n)
+		h = hash_combine(h, hash_eql(pvec_nth(vec, n)));
+
+	return h;
+}
+
+static void pvec_traits_gc_mark(ref_t instance)
+{
+	sl_pvec_t *vec = (sl_pvec_t*)instance.data.object;
+	ref_gc_mark(vec->root);
+	ref_gc_mark(vec->tail);
+}
+
+static void pvec_traits_gc_release_refs(ref_t instance)
+{
+	sl_pvec_t *vec = (sl_pvec_t*)instance.data.object;
+	release_ref(&vec->root);
+	release_ref(&vec->tail);
+}
+
+static void pvec_traits_gc_free_mem(ref_t instance)
+{
+	sl_pvec_t *vec = (sl_pvec_t*)instance.data.object;
+	X_FREE(vec);
+}
+
+static const type_traits_t pvec_traits =
+{
+	0, /* not evaluable */
+	0, /* not executable */
+	pvec_traits_print,
+	pvec_traits_type_name,
+	pvec_traits_eq,
+	pvec_traits_eql,
+	pvec_traits_hash,
+	gc_traits_addref,
+	gc_traits_release,
+	pvec_traits_gc_mark,
+	pvec_traits_gc_release_refs,
+	pvec_traits_gc_free_mem
+};
+const type_traits_t *pvec_type = &pvec_traits;
+
+static sl_pvec_t *_alloc_pvec(int state)
+{
+	sl_pvec_t *vec;
+
+	vec = (sl_pvec_t*)X_MALLOC(sizeof(sl_pvec_t));
+	gc_init_object(&vec->gc, pvec_type);
+
+	vec->count = 0;
+	vec->shift = PVEC_BITS;
+	vec->root = nil();
+	vec->tail = nil();
+	vec->state = state;
+	return vec;
+}
+
+ref_t make_pvec()
+{
+	ref_t ref;
+
+	ref.type = pvec_type;
+	ref.data.object = &_alloc_pvec(PVEC_PERSISTENT)->gc;
+	return ref;
+}
+
+ref_t pvec_copy(sl_pvec_t *vec, int state)
+{
+	ref_t ref;
+	sl_pvec_t *copy;
+
+	copy = _alloc_pvec(state);
+	copy->count = vec->count;
+	copy->shift = vec->shift;
+	copy->root = clone_ref(vec->root);
+	copy->tail = clone_ref(vec->tail);
+
+	ref.type = pvec_type;
+	ref.data.object = &copy->gc;
+	return ref;
+}
+
+/* the index of the first item in the tail */
+static size_t _tail_offset(sl_pvec_t *vec)
+{
+	if (vec->count < PVEC_WIDTH)
+		return 0;
+	return ((vec->count - 1) >> PVEC_BITS) << PVEC_BITS;
+}
+
+/* returns the leaf holding item n */
+static pvec_node_t *_leaf_for(sl_pvec_t *vec, size_t n)
+{
+	pvec_node_t *node;
+	unsigned level;
+
+	if (n >= _tail_offset(vec))
+		return PVEC_NODE(vec->tail);
+
+	node = PVEC_NODE(vec->root);
+	for (level = vec->shift; level; level -= PVEC_BITS)
+		node = PVEC_NODE(node->items[(n >> level) & PVEC_MASK]);
+	return node;
+}
+
+ref_t pvec_nth(sl_pvec_t *vec, size_t n)
+{
+	assert(n < vec->count);
+	return _leaf_for(vec, n)->items[n & PVEC_MASK];
+}
+
+/* puts leaf, the full tail, at the end of the tree below *slot, a node at level */
+static void _push_leaf(sl_pvec_t *vec, ref_t *slot, unsigned level, ref_t leaf)
+{
+	ref_t *child = &_editable(slot)->items[((vec->count - 1) >> level) & PVEC_MASK];
+
+	if (level == PVEC_BITS)
+		*child = leaf;
+	else
+		_push_leaf(vec, child, level - PVEC_BITS, leaf);
+}
+
+void pvec_push(sl_pvec_t *vec, ref_t x)
+{
+	ref_t root;
+
+	assert(vec->state != PVEC_FINISHED);
+
+	if (vec->count - _tail_offset(vec) == PVEC_WIDTH)
+	{
+		/* the tail is full, so it goes into the tree, which gets a new root if it's full too */
+		if ((vec->count >> PVEC_BITS) > ((size_t)1 << vec->shift))
+		{
+			root = _new_node();
+			PVEC_NODE(root)->items[0] = vec->root;
+			vec->root = root;
+			vec->shift += PVEC_BITS;
+		}
+		_push_leaf(vec, &vec->root, vec->shift, vec->tail);
+		vec->tail = nil();
+	}
+
+	_editable(&vec->tail)->items[vec->count & PVEC_MASK] = clone_ref(x);
+	++vec->count;
+}
+
+void pvec_set(sl_pvec_t *vec, size_t n, ref_t x)
+{
+	pvec_node_t *leaf;
+	ref_t *slot, old;
+	unsigned level;
+
+	assert(n < vec->count && vec->state != PVEC_FINISHED);
+
+	if (n >= _tail_offset(vec))
+		leaf = _editable(&vec->tail);
+	else
+	{
+		slot = &vec->root;
+		for (level = vec->shift; level; level -= PVEC_BITS)
+			slot = &_editable(slot)->items[(n >> level) & PVEC_MASK];
+		leaf = _editable(slot);
+	}
+
+	old = leaf->items[n & PVEC_MASK];
+	leaf->items[n & PVEC_MASK] = clone_ref(x);
+	release_ref(&old);
+}
+
+/* takes the last leaf out of the tree below *slot, a node at level, and empties *slot if
+   that leaf was all it held */
+static void _pop_leaf(sl_pvec_t *vec, ref_t *slot, unsigned level)
+{
+	size_t last = vec->count - 2; /* an index in the last leaf */
+
+	if ((last & (((size_t)1 << (level + PVEC_BITS)) - 1)) < PVEC_WIDTH)
+		release_ref(slot);
+	else if (level == PVEC_BITS)
+		release_ref(&_editable(slot)->items[(last >> level) & PVEC_MASK]);
+	else
+		_pop_leaf(vec, &_editable(slot)->items[(last >> level) & PVEC_MASK], level - PVEC_BITS);
+}
+
+void pvec_pop(sl_pvec_t *vec)
+{
+	ref_t leaf, root;
+
+	assert(vec->count && vec->state != PVEC_FINISHED);
+
+	if (vec->count - _tail_offset(vec) > 1)
+		release_ref(&_editable(&vec->tail)->items[(vec->count - 1) & PVEC_MASK]);
+	else if (vec->count == 1)
+		release_ref(&vec->tail);
+	else
+	{
+		/* the tail only held the last item, so the last leaf of the tree becomes the tail */
+		leaf.type = pvec_node_type;
+		leaf.data.object = &_leaf_for(vec, vec->count - 2)->gc;
+		leaf = clone_ref(leaf);
+		release_ref(&vec->tail);
+		vec->tail = leaf;
+
+		_pop_leaf(vec, &vec->root, vec->shift);
+
+		/* a root with only one child is replaced by that child */
+		if (vec->root.type == NIL)
+			vec->shift = PVEC_BITS;
+		else if (vec->shift > PVEC_BITS && PVEC_NODE(vec->root)->items[1].type == NIL)
+		{
+			root = clone_ref(PVEC_NODE(vec->root)->items[0]);
+			release_ref(&vec->root);
+			vec->root = root;
+			vec->shift -= PVEC_BITS;
+		}
+	}
+
+	--vec->count;
+}
+
+void pvec_finish(sl_pvec_t *vec)
+{
+	release_ref(&vec->root);
+	release_ref(&vec->tail);
+	vec->count = 0;
+	vec->shift = PVEC_BITS;
+	vec->state = PVEC_FINISHED;
+}
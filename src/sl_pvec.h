@@ -0,0 +1,67 @@
+/* vim: set ts=4 sts=4 sw=4 noet ai: */
+#ifndef SL_PVEC_H
+#define SL_PVEC_H
+
+#include "gc.h"
+#include "ref.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PVEC_BITS (5)
+#define PVEC_WIDTH (1 << PVEC_BITS)
+#define PVEC_MASK (PVEC_WIDTH - 1)
+
+/* a node of a persistent vector's tree.  a leaf holds PVEC_WIDTH items, and any other
+   node holds refs to PVEC_WIDTH nodes of the level below; slots not in use are nil */
+typedef struct pvec_node_ts
+{
+	gc_object_t gc;
+	ref_t items[PVEC_WIDTH];
+} pvec_node_t;
+
+/* the states of a pvec */
+#define PVEC_PERSISTENT (0)
+#define PVEC_TRANSIENT (1)
+#define PVEC_FINISHED (2) /* a transient that persistent! has been called on */
+
+/* a persistent vector: a tree of nodes PVEC_WIDTH wide, which versions of the vector
+   share, with the last leaf kept out of the tree as the tail so that adding to the end
+   is cheap.  a node is only changed in place when nothing else refers to it, and is
+   copied otherwise, so a vector made from another by pvec_copy only copies the nodes on
+   the paths it changes */
+typedef struct sl_pvec_ts
+{
+	gc_object_t gc;
+	size_t count;
+	unsigned shift; /* the level of the root: how far an index is shifted to index it */
+	ref_t root; /* a node holding the items before the tail, or nil */
+	ref_t tail; /* a leaf holding the last 1 to PVEC_WIDTH items, or nil when empty */
+	int state;
+} sl_pvec_t;
+
+/* returns a new, empty, persistent vector */
+ref_t make_pvec();
+
+/* returns a new vector with vec's items, sharing its nodes; state is PVEC_PERSISTENT
+   or PVEC_TRANSIENT */
+ref_t pvec_copy(sl_pvec_t *vec, int state);
+
+/* returns item n of the vector, without adding a reference to it */
+ref_t pvec_nth(sl_pvec_t *vec, size_t n);
+
+/* these change vec itself, so for a persistent vector they must only be used on a new
+   one from pvec_copy that nothing else has seen yet */
+void pvec_push(sl_pvec_t *vec, ref_t x); /* adds x to the end */
+void pvec_set(sl_pvec_t *vec, size_t n, ref_t x); /* n must be below vec->count */
+void pvec_pop(sl_pvec_t *vec); /* removes the last item; vec mustn't be empty */
+
+/* drops a transient's items and marks it PVEC_FINISHED */
+void pvec_finish(sl_pvec_t *vec);
+
+#ifdef __cplusplus
+} /* end extern "C" */
+#endif
+
+#endif
@@ -0,0 +1,234 @@
+/* vim: set ts=4 sts=4 sw=4 noet ai: */
+#include "global.h"
+
+#include "smalisp.h"
+#include "gc.h"
+#include "symbol.h"
+#include "sl_string.h"
+#include "sl_sorted_map.h"
+
+/* the kinds of key, in the order they sort in */
+#define KEY_NUMBER (0)
+#define KEY_STRING (1)
+#define KEY_SYMBOL (2)
+#define KEY_INVALID (-1)
+
+static int _key_kind(ref_t key)
+{
+	if (key.type == integer_type)
+		return KEY_NUMBER;
+	else if (key.type == real_type)
+		return (key.data.real == key.data.real) ? KEY_NUMBER : KEY_INVALID; /* NaNs don't sort */
+	else if (key.type == string_type)
+		return KEY_STRING;
+	else if (key.type == symbol_type)
+		return KEY_SYMBOL;
+	return KEY_INVALID;
+}
+
+static int _compare_strings(string_t *a, string_t *b)
+{
+	size_t len = a->len < b->len ? a->len : b->len;
+	int c = memcmp(string_c_str(a), string_c_str(b), len);
+
+	if (c)
+		return c;
+	return (a->len > b->len) - (a->len < b->len);
+}
+
+int sorted_map_compare_keys(ref_t a, ref_t b)
+{
+	int ka = _key_kind(a), kb = _key_kind(b);
+
+	if (ka != kb)
+		return ka - kb;
+
+	switch (ka)
+	{
+	case KEY_NUMBER:
+		if (a.type == integer_type && b.type == integer_type)
+			return (a.data.integer > b.data.integer) - (a.data.integer < b.data.integer);
+		if (a.type == integer_type)
+			return compare_integer_real(a.data.integer, b.data.real);
+		if (b.type == integer_type)
+			return -compare_integer_real(b.data.integer, a.data.real);
+		return (a.data.real > b.data.real) - (a.data.real < b.data.real);
+	case KEY_STRING:
+		return _compare_strings(a.data.str, b.data.str);
+	case KEY_SYMBOL:
+		return _compare_strings(a.data.symb->name, b.data.symb->name);
+	}
+
+	return 0;
+}
+
+int sorted_map_key_ok(ref_t key)
+{
+	return _key_kind(key) != KEY_INVALID;
+}
+
+/* the tree's comparison function: both sides point at keys */
+static int _sorted_map_rbt_cmp(void *a, void *b)
+{
+	return sorted_map_compare_keys(*(ref_t*)a, *(ref_t*)b);
+}
+
+/* rbtn_traverse callbacks */
+
+static void _mark_node(void *node)
+{
+	sorted_map_entry_t *e = SORTED_MAP_ENTRY((rbtn_t*)node);
+	ref_gc_mark(e->key);
+	ref_gc_mark(e->value);
+}
+
+static void _release_node(void *node)
+{
+	sorted_map_entry_t *e = SORTED_MAP_ENTRY((rbtn_t*)node);
+	release_ref(&e->key);
+	release_ref(&e->value);
+}
+
+static void _free_node_entry(void *node)
+{
+	X_FREE(((rbtn_t*)node)->data);
+}
+
+static void sorted_map_traits_gc_mark(ref_t instance)
+{
+	rbtn_traverse(((sl_sorted_map_t*)instance.data.object)->root, _mark_node);
+}
+
+static void sorted_map_traits_gc_release_refs(ref_t instance)
+{
+	rbtn_traverse(((sl_sorted_map_t*)instance.data.object)->root, _release_node);
+}
+
+static void sorted_map_traits_gc_free_mem(ref_t instance)
+{
+	sl_sorted_map_t *map = (sl_sorted_map_t*)instance.data.object;
+
+	assert(map);
+
+	rbtn_traverse(map->root, _free_node_entry);
+	rbtn_free_all(map->root);
+	X_FREE(map);
+}
+
+static void sorted_map_traits_print(ref_t instance, FILE *to)
+{
+	fprintf(to, "#<sorted-map %lu>", (unsigned long)((sl_sorted_map_t*)instance.data.object)->count);
+}
+
+static ref_t sorted_map_traits_type_name(ref_t instance)
+{
+	return make_symbol("sorted-map", 0);
+}
+
+static int sorted_map_traits_eq(ref_t a, ref_t b)
+{
+	return a.data.object == b.data.object;
+}
+
+static const type_traits_t sorted_map_traits =
+{
+	0, /* not evaluable */
+	0, /* not executable */
+	sorted_map_traits_print,
+	sorted_map_traits_type_name,
+	sorted_map_traits_eq,
+	sorted_map_traits_eq, /* eq and eql do the same thing for sorted maps */
+	hash_eq,
+	gc_traits_addref,
+	gc_traits_release,
+	sorted_map_traits_gc_mark,
+	sorted_map_traits_gc_release_refs,
+	sorted_map_traits_gc_free_mem
+};
+const type_traits_t *sorted_map_type = &sorted_map_traits;
+
+ref_t make_sorted_map()
+{
+	ref_t ref;
+	sl_sorted_map_t *map;
+
+	map = (sl_sorted_map_t*)X_MALLOC(sizeof(sl_sorted_map_t));
+	gc_init_object(&map->gc, sorted_map_type);
+
+	map->root = 0;
+	map->count = 0;
+
+	ref.type = sorted_map_type;
+	ref.data.object = &map->gc;
+	return ref;
+}
+
+sorted_map_entry_t *sorted_map_find(sl_sorted_map_t *map, ref_t key)
+{
+	rbtn_t *node;
+
+	if (!sorted_map_key_ok(key))
+		return 0;
+
+	node = rbtn_findins(&map->root, 0, &key, 0, _sorted_map_rbt_cmp, 0, 0, 0);
+	return node ? SORTED_MAP_ENTRY(node) : 0;
+}
+
+rbtn_t *sorted_map_floor(sl_sorted_map_t *map, ref_t key)
+{
+	if (!sorted_map_key_ok(key))
+		return 0;
+	return rbtn_floor(map->root, &key, _sorted_map_rbt_cmp);
+}
+
+rbtn_t *sorted_map_ceiling(sl_sorted_map_t *map, ref_t key)
+{
+	if (!sorted_map_key_ok(key))
+		return 0;
+	return rbtn_ceiling(map->root, &key, _sorted_map_rbt_cmp);
+}
+
+void sorted_map_put(sl_sorted_map_t *map, ref_t key, ref_t value)
+{
+	rbtn_t *node;
+	sorted_map_entry_t *e;
+	ref_t old;
+	int added = 0;
+
+	assert(sorted_map_key_ok(key));
+
+	/* a new node starts off holding the key that was searched for, which is
+	   replaced by a new entry */
+	node = rbtn_findins(&map->root, 0, &key, 1, _sorted_map_rbt_cmp, 0, 0, &added);
+	if (added)
+	{
+		e = (sorted_map_entry_t*)X_MALLOC(sizeof(sorted_map_entry_t));
+		e->key = clone_ref(key);
+		e->value = clone_ref(value);
+		node->data = e;
+		++map->count;
+	}
+	else
+	{
+		e = SORTED_MAP_ENTRY(node);
+		old = e->value;
+		e->value = clone_ref(value);
+		release_ref(&old);
+	}
+}
+
+int sorted_map_delete(sl_sorted_map_t *map, ref_t key)
+{
+	sorted_map_entry_t *e = sorted_map_find(map, key);
+
+	if (!e)
+		return 0;
+
+	rbtn_del(&map->root, 0, e, _sorted_map_rbt_cmp, 0, 0);
+	--map->count;
+
+	release_ref(&e->key);
+	release_ref(&e->value);
+	X_FREE(e);
+	return 1;
+}
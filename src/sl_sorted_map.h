@@ -0,0 +1,63 @@
+/* vim: set ts=4 sts=4 sw=4 noet ai: */
+#ifndef SL_SORTED_MAP_H
+#define SL_SORTED_MAP_H
+
+#include "gc.h"
+#include "ref.h"
+#include "rbt.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* the data of each tree node.  the key comes first, so that a pointer to an entry is
+   also a pointer to its key */
+typedef struct sorted_map_entry_ts
+{
+	ref_t key;
+	ref_t value;
+} sorted_map_entry_t;
+
+/* a map kept sorted by key, in a red-black tree.  keys can be integers, reals, strings
+   or symbols: numbers sort before strings, and strings before symbols.  integers and
+   reals are compared by value, and strings and symbols by their characters */
+typedef struct sl_sorted_map_ts
+{
+	gc_object_t gc;
+	rbtn_t *root;
+	size_t count;
+} sl_sorted_map_t;
+
+/* returns a new, empty map */
+ref_t make_sorted_map();
+
+/* returns 1 if key can be used as a key in a sorted map */
+int sorted_map_key_ok(ref_t key);
+
+/* returns the entry for key, or 0 if there isn't one */
+sorted_map_entry_t *sorted_map_find(sl_sorted_map_t *map, ref_t key);
+
+/* return the node holding the greatest key not above key (the floor) or the least key
+   not below it (the ceiling), or 0 if there isn't one.  rbtn_next walks on from there,
+   and rbtn_first(map->root) gives the node with the least key */
+rbtn_t *sorted_map_floor(sl_sorted_map_t *map, ref_t key);
+rbtn_t *sorted_map_ceiling(sl_sorted_map_t *map, ref_t key);
+
+/* the entry held by a node of a map's tree */
+#define SORTED_MAP_ENTRY(node) ((sorted_map_entry_t*)(node)->data)
+
+/* sets the value for key, adding references to both.  key must be one that
+   sorted_map_key_ok accepts */
+void sorted_map_put(sl_sorted_map_t *map, ref_t key, ref_t value);
+
+/* removes the entry for key; returns 0 if there wasn't one */
+int sorted_map_delete(sl_sorted_map_t *map, ref_t key);
+
+/* compares two keys; returns <0, 0 or >0 */
+int sorted_map_compare_keys(ref_t a, ref_t b);
+
+#ifdef __cplusplus
+} /* end extern "C" */
+#endif
+
+#endif
@@ -92,6 +92,22 @@ static int string_traits_eql(ref_t a, ref_t b)
 	return (len1 == len2) && (memcmp(s1, s2, len1) == 0);
 }
 
+/* FNV-1a over the characters */
+static size_t string_traits_hash(ref_t instance)
+{
+	const unsigned char *s = (const unsigned char*)instance.data.str + sizeof(string_t);
+	uint64_t h = UINT64_C(14695981039346656037);
+	size_t n;
+
+	for (n = 0; n != instance.data.str->len; ++n)
+	{
+		h ^= s[n];
+		h *= UINT64_C(1099511628211);
+	}
+
+	return hash_mix(h);
+}
+
 #if 0
 static ref_t string_traits_eval(ref_t instance, ref_t context)
 {
@@ -111,6 +127,7 @@ static const type_traits_t string_traits =
 	string_traits_type_name,
 	string_traits_eq,
 	string_traits_eql,
+	string_traits_hash,
 	string_traits_addref,
 	string_traits_release,
 	0, /* not garbage collected */
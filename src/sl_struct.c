@@ -0,0 +1,351 @@
+/* vim: set ts=4 sts=4 sw=4 noet ai: */
+#include "global.h"
+
+#include <stddef.h>
+
+#include "smalisp.h"
+#include "gc.h"
+#include "cons.h"
+#include "symbol.h"
+#include "sl_string.h"
+#include "sl_struct.h"
+
+/* descriptors */
+
+static void struct_desc_traits_print(ref_t instance, FILE *to)
+{
+	fprintf(to, "#<struct-type ");
+	print(((struct_desc_t*)instance.data.object)->name, to);
+	fprintf(to, ">");
+}
+
+static int struct_desc_traits_eq(ref_t a, ref_t b)
+{
+	return a.data.object == b.data.object;
+}
+
+static void struct_desc_traits_gc_mark(ref_t instance)
+{
+	struct_desc_t *desc = (struct_desc_t*)instance.data.object;
+	size_t n;
+
+	ref_gc_mark(desc->name);
+	for (n = 0; n != desc->num_fields; ++n)
+		ref_gc_mark(desc->fields[n]);
+}
+
+static void struct_desc_traits_gc_release_refs(ref_t instance)
+{
+	struct_desc_t *desc = (struct_desc_t*)instance.data.object;
+	size_t n;
+
+	release_ref(&desc->name);
+	for (n = 0; n != desc->num_fields; ++n)
+		release_ref(&desc->fields[n]);
+}
+
+static void struct_desc_traits_gc_free_mem(ref_t instance)
+{
+	struct_desc_t *desc = (struct_desc_t*)instance.data.object;
+	X_FREE(desc);
+}
+
+static const type_traits_t struct_desc_traits =
+{
+	0, /* not evaluable */
+	0, /* not executable */
+	struct_desc_traits_print,
+	0, /* no type name (hidden type) */
+	struct_desc_traits_eq,
+	struct_desc_traits_eq, /* eq and eql do the same thing for descriptors */
+	hash_eq,
+	gc_traits_addref,
+	gc_traits_release,
+	struct_desc_traits_gc_mark,
+	struct_desc_traits_gc_release_refs,
+	struct_desc_traits_gc_free_mem
+};
+const type_traits_t *struct_desc_type = &struct_desc_traits;
+
+ref_t make_struct_desc(ref_t name, ref_t fields)
+{
+	ref_t ref, it;
+	struct_desc_t *desc;
+	size_t num_fields = 0, n;
+
+	for (it = fields; it.type == cons_type; it = ((cons_t*)it.data.object)->cdr)
+		++num_fields;
+
+	desc = (struct_desc_t*)X_MALLOC(offsetof(struct_desc_t, fields) + num_fields * sizeof(ref_t));
+	gc_init_object(&desc->gc, struct_desc_type);
+
+	desc->name = clone_ref(name);
+	desc->num_fields = num_fields;
+	for (n = 0, it = fields; n != num_fields; ++n, it = ((cons_t*)it.data.object)->cdr)
+		desc->fields[n] = clone_ref(((cons_t*)it.data.object)->car);
+
+	ref.type = struct_desc_type;
+	ref.data.object = &desc->gc;
+	return ref;
+}
+
+/* records */
+
+static void struct_traits_print(ref_t instance, FILE *to)
+{
+	struct_record_t *rec = (struct_record_t*)instance.data.object;
+	size_t n;
+
+	if (rec->gc.flags & GC_FLAG_PRINTING)
+	{
+		fprintf(to, "#s(...)");
+		return;
+	}
+	rec->gc.flags |= GC_FLAG_PRINTING;
+
+	fprintf(to, "#s(");
+	print(rec->desc->name, to);
+	for (n = 0; n != rec->desc->num_fields; ++n)
+	{
+		fprintf(to, " ");
+		print(rec->desc->fields[n], to);
+		fprintf(to, " ");
+		print(rec->slots[n], to);
+	}
+	fprintf(to, ")");
+
+	rec->gc.flags &= ~GC_FLAG_PRINTING;
+}
+
+/* the type of a record is the name of its struct */
+static ref_t struct_traits_type_name(ref_t instance)
+{
+	return clone_ref(((struct_record_t*)instance.data.object)->desc->name);
+}
+
+static int struct_traits_eq(ref_t a, ref_t b)
+{
+	return a.data.object == b.data.object;
+}
+
+static int struct_traits_eql(ref_t a, ref_t b)
+{
+	struct_record_t *ar = (struct_record_t*)a.data.object;
+	struct_record_t *br = (struct_record_t*)b.data.object;
+	size_t n;
+
+	if (ar->desc != br->desc)
+		return 0;
+
+	for (n = 0; n != ar->desc->num_fields; ++n)
+	{
+		if (!eql(ar->slots[n], br->slots[n]))
+			return 0;
+	}
+
+	return 1;
+}
+
+static size_t struct_traits_hash(ref_t instance)
+{
+	struct_record_t *rec = (struct_record_t*)instance.data.object;
+	size_t h = hash_mix((uint64_t)(uintptr_t)rec->desc), n;
+
+	for (n = 0; n != rec->desc->num_fields && n != HASH_MAX_ITEMS; ++n)
+		h = hash_combine(h, hash_eql(rec->slots[n]));
+
+	return h;
+}
+
+static void struct_traits_gc_mark(ref_t instance)
+{
+	struct_record_t *rec = (struct_record_t*)instance.data.object;
+	size_t n;
+
+	gc_mark(&rec->desc->gc);
+	for (n = 0; n != rec->desc->num_fields; ++n)
+		ref_gc_mark(rec->slots[n]);
+}
+
+static void struct_traits_gc_release_refs(ref_t instance)
+{
+	struct_record_t *rec = (struct_record_t*)instance.data.object;
+	size_t n;
+
+	/* the descriptor is released last; the slot count comes from it */
+	for (n = 0; n != rec->desc->num_fields; ++n)
+		release_ref(&rec->slots[n]);
+	gc_release_ref(&rec->desc->gc);
+}
+
+static void struct_traits_gc_free_mem(ref_t instance)
+{
+	struct_record_t *rec = (struct_record_t*)instance.data.object;
+	X_FREE(rec);
+}
+
+static const type_traits_t struct_traits =
+{
+	0, /* not evaluable */
+	0, /* not executable */
+	struct_traits_print,
+	struct_traits_type_name,
+	struct_traits_eq,
+	struct_traits_eql,
+	struct_traits_hash,
+	gc_traits_addref,
+	gc_traits_release,
+	struct_traits_gc_mark,
+	struct_traits_gc_release_refs,
+	struct_traits_gc_free_mem
+};
+const type_traits_t *struct_type = &struct_traits;
+
+/* returns a new record with its slots set from argv; missing ones are nil */
+static ref_t _make_record(struct_desc_t *desc, const ref_t *argv, size_t argc)
+{
+	ref_t ref;
+	struct_record_t *rec;
+	size_t n;
+
+	rec = (struct_record_t*)X_MALLOC(offsetof(struct_record_t, slots) + desc->num_fields * sizeof(ref_t));
+	gc_init_object(&rec->gc, struct_type);
+
+	gc_add_ref(&desc->gc);
+	rec->desc = desc;
+	for (n = 0; n != desc->num_fields; ++n)
+		rec->slots[n] = n < argc ? clone_ref(argv[n]) : nil();
+
+	ref.type = struct_type;
+	ref.data.object = &rec->gc;
+	return ref;
+}
+
+/* procedures */
+
+/* returns the record argument, warning if it isn't an instance of desc */
+static struct_record_t *_record_arg(struct_proc_t *proc, const ref_t *argv, size_t argc)
+{
+	if (argc && argv[0].type == struct_type && ((struct_record_t*)argv[0].data.object)->desc == proc->desc)
+		return (struct_record_t*)argv[0].data.object;
+
+	LOG_WARNING_X("%s called on something that isn't the right kind of struct", string_c_str(proc->name.data.symb->name));
+	return 0;
+}
+
+static ref_t _struct_proc_call(ref_t instance, const ref_t *argv, size_t argc, ref_t env)
+{
+	struct_proc_t *proc = (struct_proc_t*)instance.data.object;
+	struct_record_t *rec;
+	ref_t old;
+
+	switch (proc->kind)
+	{
+	case STRUCT_PROC_MAKE:
+		if (argc > proc->desc->num_fields)
+			LOG_WARNING_X("%s called with too many arguments", string_c_str(proc->name.data.symb->name));
+		return _make_record(proc->desc, argv, argc);
+
+	case STRUCT_PROC_TEST:
+		if (argc && argv[0].type == struct_type && ((struct_record_t*)argv[0].data.object)->desc == proc->desc)
+			return make_symbol("t", 0);
+		return nil();
+
+	case STRUCT_PROC_GET:
+		rec = _record_arg(proc, argv, argc);
+		return rec ? clone_ref(rec->slots[proc->index]) : nil();
+
+	case STRUCT_PROC_SET:
+		rec = _record_arg(proc, argv, argc);
+		if (!rec)
+			return nil();
+		old = rec->slots[proc->index];
+		rec->slots[proc->index] = argc > 1 ? clone_ref(argv[1]) : nil();
+		release_ref(&old);
+		return clone_ref(rec->slots[proc->index]);
+	}
+
+	return nil();
+}
+
+/* evaluates the arguments, as foreign vexecs do */
+static ref_t struct_proc_traits_execute(ref_t instance, ref_t args, ref_t calling_context)
+{
+	return call_evaluated(_struct_proc_call, instance, args, calling_context);
+}
+
+static void struct_proc_traits_print(ref_t instance, FILE *to)
+{
+	fprintf(to, "#<foreign-exec ");
+	print(((struct_proc_t*)instance.data.object)->name, to);
+	fprintf(to, ">");
+}
+
+/* as far as lisp code is concerned, these are just more foreign execs */
+static ref_t struct_proc_traits_type_name(ref_t instance)
+{
+	return make_symbol("foreign-exec", 0);
+}
+
+static int struct_proc_traits_eq(ref_t a, ref_t b)
+{
+	return a.data.object == b.data.object;
+}
+
+static void struct_proc_traits_gc_mark(ref_t instance)
+{
+	struct_proc_t *proc = (struct_proc_t*)instance.data.object;
+	gc_mark(&proc->desc->gc);
+	ref_gc_mark(proc->name);
+}
+
+static void struct_proc_traits_gc_release_refs(ref_t instance)
+{
+	struct_proc_t *proc = (struct_proc_t*)instance.data.object;
+	gc_release_ref(&proc->desc->gc);
+	release_ref(&proc->name);
+}
+
+static void struct_proc_traits_gc_free_mem(ref_t instance)
+{
+	struct_proc_t *proc = (struct_proc_t*)instance.data.object;
+	X_FREE(proc);
+}
+
+static const type_traits_t struct_proc_traits =
+{
+	0, /* not evaluable */
+	struct_proc_traits_execute,
+	struct_proc_traits_print,
+	struct_proc_traits_type_name,
+	struct_proc_traits_eq,
+	struct_proc_traits_eq, /* eq and eql do the same thing for struct procedures */
+	hash_eq,
+	gc_traits_addref,
+	gc_traits_release,
+	struct_proc_traits_gc_mark,
+	struct_proc_traits_gc_release_refs,
+	struct_proc_traits_gc_free_mem
+};
+const type_traits_t *struct_proc_type = &struct_proc_traits;
+
+ref_t make_struct_proc(ref_t desc, struct_proc_kind_t kind, size_t index, ref_t name)
+{
+	ref_t ref;
+	struct_proc_t *proc;
+
+	assert(desc.type == struct_desc_type);
+
+	proc = (struct_proc_t*)X_MALLOC(sizeof(struct_proc_t));
+	gc_init_object(&proc->gc, struct_proc_type);
+
+	gc_add_ref(desc.data.object);
+	proc->desc = (struct_desc_t*)desc.data.object;
+	proc->kind = kind;
+	proc->index = index;
+	proc->name = clone_ref(name);
+
+	ref.type = struct_proc_type;
+	ref.data.object = &proc->gc;
+	return ref;
+}
@@ -0,0 +1,60 @@
+/* vim: set ts=4 sts=4 sw=4 noet ai: */
+#ifndef SL_STRUCT_H
+#define SL_STRUCT_H
+
+#include "gc.h"
+#include "ref.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* the type descriptor that defstruct makes: the struct's name and its field names */
+typedef struct struct_desc_ts
+{
+	gc_object_t gc;
+	ref_t name;
+	size_t num_fields;
+	ref_t fields[1]; /* num_fields of them */
+} struct_desc_t;
+
+/* an instance of a struct.  it's a single block, with the slots straight after the
+   pointer to its descriptor */
+typedef struct struct_record_ts
+{
+	gc_object_t gc;
+	struct_desc_t *desc;
+	ref_t slots[1]; /* desc->num_fields of them */
+} struct_record_t;
+
+/* what a struct procedure does */
+typedef enum struct_proc_kind_ts
+{
+	STRUCT_PROC_MAKE,   /* (make-name field...) */
+	STRUCT_PROC_TEST,   /* (name? x) */
+	STRUCT_PROC_GET,    /* (name-field x) */
+	STRUCT_PROC_SET     /* (set-name-field! x value); returns value */
+} struct_proc_kind_t;
+
+/* a constructor, predicate or accessor for one struct type.  these are called like
+   foreign vexecs, but they carry their descriptor and slot index with them */
+typedef struct struct_proc_ts
+{
+	gc_object_t gc;
+	struct_desc_t *desc;
+	struct_proc_kind_t kind;
+	size_t index; /* the slot, for STRUCT_PROC_GET and STRUCT_PROC_SET */
+	ref_t name; /* the name it was defined with, for printing */
+} struct_proc_t;
+
+/* returns a new descriptor; fields is a list of symbols */
+ref_t make_struct_desc(ref_t name, ref_t fields);
+
+/* returns a new struct procedure for a descriptor */
+ref_t make_struct_proc(ref_t desc, struct_proc_kind_t kind, size_t index, ref_t name);
+
+#ifdef __cplusplus
+} /* end extern "C" */
+#endif
+
+#endif
@@ -0,0 +1,163 @@
+/* vim: set ts=4 sts=4 sw=4 noet ai: */
+#include "global.h"
+
+#include "smalisp.h"
+#include "gc.h"
+#include "cons.h"
+#include "sl_vector.h"
+
+static void vector_traits_gc_mark(ref_t instance)
+{
+	sl_vector_t *vec = (sl_vector_t*)instance.data.object;
+	size_t n;
+
+	assert(vec);
+
+	for (n = 0; n != vec->items.size; ++n)
+		ref_gc_mark(SL_VECTOR_NTH(vec, n));
+}
+
+static void vector_traits_gc_release_refs(ref_t instance)
+{
+	sl_vector_t *vec = (sl_vector_t*)instance.data.object;
+	size_t n;
+
+	assert(vec);
+
+	for (n = 0; n != vec->items.size; ++n)
+		release_ref(&SL_VECTOR_NTH(vec, n));
+}
+
+static void vector_traits_gc_free_mem(ref_t instance)
+{
+	sl_vector_t *vec = (sl_vector_t*)instance.data.object;
+	assert(vec);
+	vector_clear(&vec->items);
+	X_FREE(vec);
+}
+
+static void vector_traits_print(ref_t instance, FILE *to)
+{
+	sl_vector_t *vec = (sl_vector_t*)instance.data.object;
+	size_t n;
+
+	assert(vec);
+
+	if (vec->gc.flags & GC_FLAG_PRINTING)
+	{
+		fprintf(to, "#(...)");
+		return;
+	}
+	vec->gc.flags |= GC_FLAG_PRINTING;
+
+	fprintf(to, "#(");
+	for (n = 0; n != vec->items.size; ++n)
+	{
+		if (n)
+			fprintf(to, " ");
+		print(SL_VECTOR_NTH(vec, n), to);
+	}
+	fprintf(to, ")");
+
+	vec->gc.flags &= ~GC_FLAG_PRINTING;
+}
+
+static ref_t vector_traits_type_name(ref_t instance)
+{
+	return make_symbol("vector", 0);
+}
+
+static int vector_traits_eq(ref_t a, ref_t b)
+{
+	return a.data.object == b.data.object;
+}
+
+static int vector_traits_eql(ref_t a, ref_t b)
+{
+	sl_vector_t *av = (sl_vector_t*)a.data.object;
+	sl_vector_t *bv = (sl_vector_t*)b.data.object;
+	size_t n;
+
+	if (av->items.size != bv->items.size)
+		return 0;
+
+	for (n = 0; n != av->items.size; ++n)
+	{
+		if (!eql(SL_VECTOR_NTH(av, n), SL_VECTOR_NTH(bv, n)))
+			return 0;
+	}
+
+	return 1;
+}
+
+static size_t vector_traits_hash(ref_t instance)
+{
+	sl_vector_t *vec = (sl_vector_t*)instance.data.object;
+	size_t h = hash_mix(vec->items.size), n;
+
+	for (n = 0; n != vec->items.size && n != HASH_MAX_ITEMS; ++n)
+		h = hash_combine(h, hash_eql(SL_VECTOR_NTH(vec, n)));
+
+	return h;
+}
+
+static const type_traits_t vector_traits =
+{
+	0, /* not evaluable */
+	0, /* not executable */
+	vector_traits_print,
+	vector_traits_type_name,
+	vector_traits_eq,
+	vector_traits_eql,
+	vector_traits_hash,
+	gc_traits_addref,
+	gc_traits_release,
+	vector_traits_gc_mark,
+	vector_traits_gc_release_refs,
+	vector_traits_gc_free_mem
+};
+const type_traits_t *vector_type = &vector_traits;
+
+static sl_vector_t *_alloc_vector(size_t size)
+{
+	sl_vector_t *vec;
+
+	vec = (sl_vector_t*)X_MALLOC(sizeof(sl_vector_t));
+	gc_init_object(&vec->gc, vector_type);
+
+	VECTOR_INIT_TYPE(&vec->items, ref_t);
+	vector_reserve(&vec->items, size);
+	return vec;
+}
+
+ref_t make_sl_vector(size_t size, ref_t fill)
+{
+	ref_t ref;
+	sl_vector_t *vec;
+
+	vec = _alloc_vector(size);
+	while (vec->items.size != size)
+		*(ref_t*)vector_insert(&vec->items, VECTOR_NPOS) = clone_ref(fill);
+
+	ref.type = vector_type;
+	ref.data.object = &vec->gc;
+	return ref;
+}
+
+ref_t list_to_sl_vector(ref_t list)
+{
+	ref_t ref, it;
+	sl_vector_t *vec;
+	size_t size = 0;
+
+	for (it = list; it.type == cons_type; it = ((cons_t*)it.data.object)->cdr)
+		++size;
+
+	vec = _alloc_vector(size);
+	for (it = list; it.type == cons_type; it = ((cons_t*)it.data.object)->cdr)
+		*(ref_t*)vector_insert(&vec->items, VECTOR_NPOS) = clone_ref(((cons_t*)it.data.object)->car);
+
+	ref.type = vector_type;
+	ref.data.object = &vec->gc;
+	return ref;
+}
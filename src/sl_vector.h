@@ -0,0 +1,33 @@
+/* vim: set ts=4 sts=4 sw=4 noet ai: */
+#ifndef SL_VECTOR_H
+#define SL_VECTOR_H
+
+#include "gc.h"
+#include "ref.h"
+#include "vector.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* a lisp vector: a garbage collected array of refs */
+typedef struct sl_vector_ts
+{
+	gc_object_t gc;
+	vector_t items; /* a vector of ref_t */
+} sl_vector_t;
+
+/* returns a vector of size items, each a reference to fill */
+ref_t make_sl_vector(size_t size, ref_t fill);
+
+/* returns a vector holding the items of a list */
+ref_t list_to_sl_vector(ref_t list);
+
+/* returns the nth item of the vector, without adding a reference to it */
+#define SL_VECTOR_NTH(v, n) (((ref_t*)(v)->items.items)[(n)])
+
+#ifdef __cplusplus
+} /* end extern "C" */
+#endif
+
+#endif
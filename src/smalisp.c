@@ -155,6 +155,7 @@ static const type_traits_t foreign_exec_traits =
 	foreign_exec_traits_type_name,
 	foreign_exec_traits_eq,
 	foreign_exec_traits_eq, /* eq and eql do the same thing for foreign_execs */
+	hash_eq,
 	0, /* not ref counted */
 	0,
 	0, /* not garbage collected */
@@ -171,9 +172,89 @@ ref_t make_foreign_exec(foreign_exec_t func)
 	return ref;
 }
 
+/* calls with up to this many arguments keep them on the C stack */
+#define EVALUATED_CALL_LOCAL_ARGS (8)
+
+ref_t call_evaluated(evaluated_call_t fn, ref_t instance, ref_t args, ref_t calling_context)
+{
+	ref_t local_argv[EVALUATED_CALL_LOCAL_ARGS];
+	ref_t *argv = local_argv, it, result;
+	size_t argc = 0, n;
+
+	for (it = args; it.type == cons_type; it = ((cons_t*)it.data.object)->cdr)
+		++argc;
+
+	/* only calls with a lot of arguments need a buffer from the heap.  a call without any
+	   still hands over an initialised buffer, holding nil */
+	if (argc > EVALUATED_CALL_LOCAL_ARGS)
+		argv = (ref_t*)X_MALLOC(sizeof(ref_t) * argc);
+	else
+		local_argv[0] = nil();
+
+	for (n = 0, it = args; n != argc; ++n, it = ((cons_t*)it.data.object)->cdr)
+		argv[n] = eval(((cons_t*)it.data.object)->car, calling_context);
+
+	result = fn(instance, argv, argc, calling_context);
+
+	for (n = 0; n != argc; ++n)
+		release_ref(&argv[n]);
+
+	if (argv != local_argv)
+	{
+		X_FREE(argv);
+	}
+
+	return result;
+}
+
+static ref_t _call_vexec(ref_t instance, const ref_t *argv, size_t argc, ref_t env)
+{
+	return instance.data.vfexec(argv, argc, env);
+}
+
+static ref_t foreign_vexec_traits_execute(ref_t instance, ref_t args, ref_t calling_context)
+{
+	return call_evaluated(_call_vexec, instance, args, calling_context);
+}
+
+static void foreign_vexec_traits_print(ref_t instance, FILE *to)
+{
+	fprintf(to, "#<foreign-exec %p>", instance.data.vfexec);
+}
+
+static int foreign_vexec_traits_eq(ref_t a, ref_t b)
+{
+	return a.data.vfexec == b.data.vfexec;
+}
+
+static const type_traits_t foreign_vexec_traits =
+{
+	0, /* not evaluable */
+	foreign_vexec_traits_execute,
+	foreign_vexec_traits_print,
+	foreign_exec_traits_type_name, /* the calling convention doesn't make any difference to lisp code */
+	foreign_vexec_traits_eq,
+	foreign_vexec_traits_eq, /* eq and eql do the same thing for foreign_execs */
+	hash_eq,
+	0, /* not ref counted */
+	0,
+	0, /* not garbage collected */
+	0,
+	0
+};
+const type_traits_t *foreign_vexec_type = &foreign_vexec_traits;
+
+ref_t make_foreign_vexec(foreign_vexec_t func)
+{
+	ref_t ref;
+	ref.type = foreign_vexec_type;
+	ref.data.vfexec = func;
+	return ref;
+}
+
 static void integer_traits_print(ref_t instance, FILE *to)
 {
-	fprintf(to, "%d", instance.data.integer);
+	fprintf(to, "%" PRId64, instance.data.integer);
 }
 
 static ref_t integer_traits_type_name(ref_t instance)
@@ -194,6 +275,7 @@ static const type_traits_t integer_traits =
 	integer_traits_type_name,
 	integer_traits_eq,
 	integer_traits_eq, /* eq and eql do the same thing for integers */
+	hash_eq,
 	0, /* not ref counted */
 	0,
 	0, /* not garbage collected */
@@ -202,7 +284,7 @@ static const type_traits_t integer_traits =
 };
 const type_traits_t *integer_type = &integer_traits;
 
-ref_t make_integer(int n)
+ref_t make_integer(int64_t n)
 {
 	ref_t ref;
 	ref.type = integer_type;
@@ -233,6 +315,7 @@ static const type_traits_t real_traits =
 	real_traits_type_name,
 	real_traits_eq,
 	real_traits_eq, /* eq and eql do the same thing for reals */
+	hash_eq,
 	0, /* not ref counted */
 	0,
 	0, /* not garbage collected */
@@ -249,6 +332,27 @@ ref_t make_real(double n)
 	return ref;
 }
 
+int compare_integer_real(int64_t i, double r)
+{
+	int64_t whole;
+	double fraction;
+
+	/* -2^63 and 2^63 are exact as doubles, and anything outside [-2^63, 2^63) is past every integer */
+	if (r >= 9223372036854775808.0)
+		return -1;
+	if (r < -9223372036854775808.0)
+		return 1;
+
+	/* r's whole part fits, and compares exactly as an integer; when that is equal to i, the
+	   fraction (which the subtraction gives exactly) decides */
+	whole = (int64_t)r;
+	if (i != whole)
+		return (i > whole) - (i < whole);
+
+	fraction = r - (double)whole;
+	return (fraction < 0) - (fraction > 0);
+}
+
 void print(ref_t val, FILE *to)
 {
 	if (val.type == NIL || val.type->print == 0)
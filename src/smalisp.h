@@ -41,6 +41,7 @@ struct type_traits_ts
 	ref_t (*type_name)(ref_t instance);
 	int (*eq)(ref_t a, ref_t b);
 	int (*eql)(ref_t a, ref_t b);
+	size_t (*hash)(ref_t instance); /* must agree with eql; see hash_eql */
 	void (*addref)(ref_t instance);
 	void (*release)(ref_t instance);
 	void (*gc_mark)(ref_t instance);
@@ -53,29 +54,55 @@ struct ref_ts
 	const type_traits_t *type;
 	union ref_data_ts
 	{
-		int integer;
+		int64_t integer;
 		double real;
 		symbol_t *symb;
 		string_t *str;
 		ref_t (*fexec)(ref_t args, ref_t assoc);
+		ref_t (*vfexec)(const ref_t *argv, size_t argc, ref_t env);
 		gc_object_t *object; /* cons, macro and closure objects */
 	} data;
 };
 
 typedef ref_t (*foreign_exec_t)(ref_t args, ref_t assoc);
 
+/* a foreign exec that is given its arguments already evaluated, in an array;
+   argv belongs to the caller, and is only valid until the function returns */
+typedef ref_t (*foreign_vexec_t)(const ref_t *argv, size_t argc, ref_t env);
+
+/* a function that call_evaluated hands the evaluated arguments of a call to instance */
+typedef ref_t (*evaluated_call_t)(ref_t instance, const ref_t *argv, size_t argc, ref_t env);
+
 #define NIL (0)
 extern const type_traits_t *string_type;
 extern const type_traits_t *symbol_type;
 extern const type_traits_t *integer_type;
 extern const type_traits_t *foreign_exec_type;
+extern const type_traits_t *foreign_vexec_type;
 extern const type_traits_t *real_type;
 extern const type_traits_t *cons_type;
+extern const type_traits_t *vector_type;
+extern const type_traits_t *f64vector_type;
+extern const type_traits_t *i64vector_type;
+extern const type_traits_t *hash_table_type;
+extern const type_traits_t *sorted_map_type;
+extern const type_traits_t *pvec_type;
+extern const type_traits_t *pvec_node_type;
+extern const type_traits_t *pmap_type;
+extern const type_traits_t *pmap_node_type;
+extern const type_traits_t *struct_type;
+extern const type_traits_t *struct_desc_type;
+extern const type_traits_t *struct_proc_type;
 extern const type_traits_t *macro_type;
 extern const type_traits_t *function_type;
 extern const type_traits_t *closure_type;
 extern const type_traits_t *stack_type;
 extern const type_traits_t *stack_frame_type;
+extern const type_traits_t *lexical_type;
+extern const type_traits_t *lambda_site_type;
+extern const type_traits_t *macro_site_type;
+extern const type_traits_t *call_site_type;
+extern const type_traits_t *case_site_type;
 
 /* registers the core functions with a stack frame */
 void register_core_lib(ref_t env);
@@ -114,21 +141,41 @@ ref_t make_macro(ref_t param_list, ref_t code, ref_t env);
 /* constructs a new raw closure */
 ref_t make_closure(ref_t param_list, ref_t code, ref_t env);
 
+/* constructs a new closure of type vt (closure_type, function_type or macro_type)
+   whose code has already been resolved to body */
+ref_t make_resolved_closure(ref_t param_list, ref_t code, ref_t body, ref_t env, const type_traits_t *vt);
+
 /* returns the nil reference */
 ref_t nil();
 
 /* returns a new integer */
-ref_t make_integer(int n);
+ref_t make_integer(int64_t n);
 
 /* returns a new real */
 ref_t make_real(double n);
 
+/* compares i with r (which mustn't be a NaN) exactly, returning <0, 0 or >0 as i is less
+   than, equal to or greater than r.  converting i to a double instead would round the big
+   ones, so that one real could equal two different integers */
+int compare_integer_real(int64_t i, double r);
+
 /* returns a foreign exec ref */
 ref_t make_foreign_exec(foreign_exec_t func);
 
+/* returns a foreign exec ref for a function that takes evaluated arguments */
+ref_t make_foreign_vexec(foreign_vexec_t func);
+
+/* evaluates args in calling_context, returns fn(instance, values, count, calling_context),
+   and releases the values.  this is how foreign vexecs are called, for other types whose
+   calls take their arguments evaluated */
+ref_t call_evaluated(evaluated_call_t fn, ref_t instance, ref_t args, ref_t calling_context);
+
 /* returns a new stack frame */
 ref_t make_stack(ref_t parent);
 
+/* returns a new stack frame with room for size bindings */
+ref_t make_stack_sized(ref_t parent, size_t size);
+
 /* rebinds the value of name to val in the given stack frame or one of its parent frames
    error if name is currently unbound */
 void stack_set(ref_t stack, ref_t name, ref_t val);
@@ -136,6 +183,13 @@ void stack_set(ref_t stack, ref_t name, ref_t val);
 /* binds or rebinds the value of name to val in the given stack frame */
 void stack_let(ref_t stack, ref_t name, ref_t val);
 
+/* marks the binding of name that is visible from the given stack frame as constant (or not);
+   returns 0 (with an error) if name is unbound */
+int stack_set_const(ref_t stack, ref_t name, int is_const);
+
+/* returns non-zero if the binding of name visible from the given stack frame is constant */
+int stack_is_const(ref_t stack, ref_t name);
+
 /* sets up all symbols to enter the given stack */
 void stack_enter(ref_t stack);
 
@@ -148,6 +202,13 @@ void unregister_gc_root(ref_t o);
 /* performs a simple mark-sweep garbage collection cycle */
 void collect_garbage();
 
+/* performs a garbage collection cycle if enough objects have been created since the last one,
+   or if one has been requested */
+void collect_garbage_if_needed();
+
+/* makes the next call to collect_garbage_if_needed perform a collection */
+void request_garbage_collection();
+
 /* increments the ref count for an object */
 void add_ref(ref_t ref);
 
@@ -176,13 +237,50 @@ int eq(ref_t a, ref_t b);
 /* tests whether two values are equal */
 int eql(ref_t a, ref_t b);
 
+/* hash values that agree with eq and eql: values which are eq (or eql) hash the same.
+   hash_eql uses the type's hash function, and puts every value of a type without one
+   into the same bucket */
+size_t hash_eq(ref_t a);
+size_t hash_eql(ref_t a);
+
+/* for type hash functions: mixes x into a well distributed hash, or h into a running hash */
+size_t hash_mix(uint64_t x);
+size_t hash_combine(size_t seed, size_t h);
+
+/* type hash functions look at no more than this many items of a container, so that
+   hashing a big structure stays cheap */
+#define HASH_MAX_ITEMS (8)
+
 /* construct a new list, where each item is the corresponding item
    in the source list, evaluated in environment a */
 ref_t map_eval(ref_t list, ref_t assoc);
 
-/* sets the given names and values in the given stack frame */
+/* evaluates each form in body in turn, returning the value of the last one (or nil if there are none) */
+ref_t eval_body(ref_t body, ref_t assoc);
+
+/* how built-in forms that end by evaluating one of their arguments, and returning its
+   value, let that last form be evaluated in tail position: they do everything before it,
+   and return 1 with *tail set to the form (which belongs to args), or 0 with *result set
+   if there was nothing left to evaluate */
+typedef int (*tail_form_t)(ref_t args, ref_t assoc, ref_t *tail, ref_t *result);
+
+/* evaluates every form in body but the last, as a tail_form_t (for do and friends) */
+int eval_body_tail(ref_t body, ref_t assoc, ref_t *tail, ref_t *result);
+
+/* binds a parameter list to the given values in the given stack frame.  after
+   &optional, a parameter can be written (name default), and default is evaluated
+   in the frame if there is no value for it; the parameter after &rest gets a
+   list of all the remaining values */
 void map_let(ref_t frame, ref_t names, ref_t vals);
 
+/* as map_let, but each value is an expression that is evaluated in assoc
+   (extra values are still evaluated, for their side effects) */
+void map_let_eval(ref_t frame, ref_t names, ref_t vals, ref_t assoc);
+
+/* returns the name that an item of a parameter list binds (without adding a
+   reference to it), or nil for &optional and &rest */
+ref_t param_name(ref_t p);
+
 /* evaluate the body of a closure, passing it the specified arguments.
    This does not evaluate the arguments, or the result of the
    closure (but can be run on closures, functions and macros).
@@ -15,40 +15,49 @@
 
 int stack_switch_count = 0;
 
+static unsigned long next_stack_epoch = 1; /* 0 is never a valid epoch */
+
 static stack_t *current_stack = 0;
 
+static void _stack_enter(stack_t *s);
+
+/* freed stacks, linked through gc.next_gc_object */
+#define STACK_POOL_DEPTH (256)
+static stack_t *stack_pool = 0;
+static size_t stack_pool_size = 0;
+
 static void stack_traits_gc_mark(ref_t instance)
 {
 	stack_t *s = (stack_t*)instance.data.object;
-	stack_frame_t **it, **end;
 
 	assert(s);
 
-	it = (stack_frame_t**)s->frames.items;
-	end = (stack_frame_t**)vector_end(&s->frames);
-	while (it != end)
-	{
-		stack_frame_t *sf = *it;
-		gc_mark(&sf->gc);
-		++it;
-	}
+	gc_mark(&s->frame->gc);
+	if (s->parent)
+		gc_mark(&s->parent->gc);
 }
 
 static void stack_traits_gc_release_refs(ref_t instance)
 {
 	stack_t *s = (stack_t*)instance.data.object;
-	stack_frame_t **it, **end;
 
 	assert(s);
 
-	it = (stack_frame_t**)s->frames.items;
-	end = (stack_frame_t**)vector_end(&s->frames);
-	while (it != end)
+	gc_release_ref(&s->frame->gc);
+	if (s->parent)
+		gc_release_ref(&s->parent->gc);
+}
+
+static void _stack_free(stack_t *s)
+{
+	if (stack_pool_size < STACK_POOL_DEPTH)
 	{
-		stack_frame_t *sf = *it;
-		gc_release_ref(&sf->gc);
-		++it;
+		s->gc.next_gc_object = (gc_object_t*)stack_pool;
+		stack_pool = s;
+		++stack_pool_size;
 	}
+	else
+		X_FREE(s);
 }
 
 static void stack_traits_gc_free_mem(ref_t instance)
@@ -57,8 +66,7 @@ static void stack_traits_gc_free_mem(ref_t instance)
 
 	assert(s);
 
-	vector_clear(&s->frames);
-	X_FREE(s);
+	_stack_free(s);
 }
 
 static void stack_traits_print(ref_t instance, FILE *to)
@@ -86,6 +94,7 @@ static const type_traits_t stack_traits =
 	stack_traits_type_name,
 	stack_traits_eq,
 	stack_traits_eq, /* eq and eql do the same thing for stacks */
+	hash_eq,
 	gc_traits_addref,
 	gc_traits_release,
 	stack_traits_gc_mark,
@@ -94,116 +103,154 @@ static const type_traits_t stack_traits =
 };
 const type_traits_t *stack_type = &stack_traits;
 
-static stack_frame_t *top_frame(stack_t *s)
-{
-	stack_frame_t **sf = (stack_frame_t**)vector_back(&s->frames);
-	if (!sf)
-		return 0;
-	else
-		return *sf;
-}
-
-static int stack_visible(stack_t *target)
+static ref_t _make_stack(ref_t parent, size_t size, int local)
 {
+	ref_t ref;
 	stack_t *s;
-	s = current_stack;
-	while (s)
-	{
-		if (s == target)
-			return -1;
 
-		s = s->parent;
+	if (parent.type != NIL && parent.type != stack_type)
+	{
+		LOG_ERROR("Called with an invalid parent; not a stack");
+		return nil();
 	}
 
-	return 0;
-}
+	if (stack_pool)
+	{
+		s = stack_pool;
+		stack_pool = (stack_t*)s->gc.next_gc_object;
+		--stack_pool_size;
+	}
+	else
+		s = (stack_t*)X_MALLOC(sizeof(stack_t));
 
-ref_t make_stack(ref_t parent)
-{
-	ref_t ref;
-	stack_frame_t **new_frame;
-	stack_t *s = (stack_t*)X_MALLOC(sizeof(stack_t));
-	gc_init_object(&s->gc, stack_type);
+	if (local)
+		gc_init_local_object(&s->gc, stack_type);
+	else
+		gc_init_object(&s->gc, stack_type);
 
 	if (parent.type == NIL)
 	{
 		s->parent = 0;
-		VECTOR_INIT_TYPE(&s->frames, stack_frame_t**);
-	}
-	else if (parent.type == stack_type)
-	{
-		stack_frame_t **it, **end;
-		s->parent = (stack_t*)parent.data.object;
-
-		VECTOR_INIT_TYPE(&s->frames, stack_frame_t**);
-		vector_reserve(&s->frames, s->parent->frames.size + 1);
-
-		s->frames.size = s->parent->frames.size;
-		memcpy(s->frames.items, s->parent->frames.items, s->parent->frames.item_size * s->parent->frames.size);
-
-		it = (stack_frame_t**)s->frames.items;
-		end = (stack_frame_t**)vector_end(&s->frames);
-		while (it != end)
-		{
-			stack_frame_t *sf = *it;
-			gc_add_ref(&sf->gc);
-
-			++it;
-		}
+		s->depth = 0;
 	}
 	else
 	{
-		LOG_ERROR("Called with an invalid parent; not a stack");
-		return nil();
+		/* the parent's frames are shared rather than copied,
+		   so creating a stack costs the same at any depth */
+		s->parent = (stack_t*)parent.data.object;
+		s->depth = s->parent->depth + 1;
+		gc_add_ref(&s->parent->gc);
 	}
 
-	new_frame = (stack_frame_t**)vector_insert(&s->frames, VECTOR_NPOS);
-	*new_frame = make_stack_frame();
+	s->frame = local ? make_local_stack_frame(size) : make_stack_frame(size);
+	if (!s->parent)
+		stack_frame_make_global(s->frame);
+	s->epoch = next_stack_epoch++;
 
 	ref.type = stack_type;
 	ref.data.object = &s->gc;
 	return ref;
 }
 
-static int _stack_frame_eq(void *sf, void *target)
+ref_t make_stack(ref_t parent)
 {
-	stack_frame_t **a = (stack_frame_t**)sf;
-	stack_frame_t **b = (stack_frame_t**)target;
-	return *a == *b;
+	return _make_stack(parent, 0, 0);
 }
 
-static void _stack_set(stack_t *s, ref_t name, ref_t val)
+ref_t make_stack_sized(ref_t parent, size_t size)
+{
+	return _make_stack(parent, size, 0);
+}
+
+ref_t make_local_stack(ref_t parent, size_t size)
 {
-	stack_frame_t **it, **front;
+	assert(parent.type == stack_type);
+	return _make_stack(parent, size, 1);
+}
 
-	it = (stack_frame_t**)vector_end(&s->frames);
-	front = (stack_frame_t**)s->frames.items;
-	while (it != front)
+void release_local_stack(ref_t *stack)
+{
+	stack_t *s;
+	ref_t frame;
+
+	assert(stack && stack->type == stack_type);
+	s = (stack_t*)stack->data.object;
+
+	/* the last thing evaluated in the call was most likely evaluated in this stack */
+	if (current_stack == s)
+		_stack_enter(s->parent);
+
+	if (s->gc.rc != 1 || s->frame->gc.rc != 1)
 	{
-		stack_slot_t *slot;
-		--it;
+		/* something kept hold of it after all (eg, an operator that looked like a
+		   function when the closure was made has since been rebound to a raw closure),
+		   so it has to be handed over to the collector */
+		gc_register_object(&s->frame->gc);
+		gc_register_object(&s->gc);
+		release_ref(stack);
+		return;
+	}
 
-		slot = stack_frame_find(*it, name, 0);
-		if (slot)
-		{
-			size_t frame_id;
+	frame.type = stack_frame_type;
+	frame.data.object = &s->frame->gc;
+	stack_frame_type->gc_release_refs(frame);
+	stack_frame_type->gc_free_mem(frame);
 
-			ref_t old_val = slot->value;
-			slot->value = clone_ref(val);
-			release_ref(&old_val);
+	gc_release_ref(&s->parent->gc);
+	_stack_free(s);
 
-			if (s == current_stack)
-				frame_id = vector_idx_from_it(&s->frames, it);
-			else
-				frame_id = vector_findr(&current_stack->frames, it, _stack_frame_eq);
+	*stack = nil();
+}
 
-			if (frame_id != VECTOR_NPOS)
-				symbol_set(name, val, frame_id);
+stack_slot_t *stack_find(stack_t *s, ref_t name, stack_frame_t **frame)
+{
+	stack_t *it;
+	stack_slot_t *slot;
 
-			return;
+	assert(name.type == symbol_type);
+
+	slot = SYMBOL_GLOBAL_SLOT(name.data.symb);
+	if (slot)
+	{
+		if (frame)
+			*frame = name.data.symb->global_frame;
+		return slot;
+	}
+
+	for (it = s; it; it = it->parent)
+	{
+		slot = stack_frame_find(it->frame, name, 0);
+		if (slot)
+		{
+			if (frame)
+				*frame = it->frame;
+			return slot;
 		}
 	}
 
+	return 0;
+}
+
+static void _stack_set(stack_t *s, ref_t name, ref_t val)
+{
+	stack_slot_t *slot;
+	stack_frame_t *frame;
+
+	slot = stack_find(s, name, &frame);
+	if (slot && (slot->flags & STACK_SLOT_CONST))
+	{
+		LOG_ERROR_X("Can't rebind %s; it is a constant", symbol_c_str(name));
+		return;
+	}
+	else if (slot)
+	{
+		ref_t old_val = slot->value;
+		slot->value = clone_ref(val);
+		stack_frame_slot_changed(frame);
+		release_ref(&old_val);
+		return;
+	}
+
 	/* we didn't find it */
 	LOG_ERROR("Didn't find given name in the stack (so it could not be rebound)");
 }
@@ -226,25 +273,17 @@ static void _stack_let(stack_t *s, ref_t name, ref_t val)
 {
 	ref_t old_val;
 	stack_slot_t *slot;
-	size_t frame_id;
-	stack_frame_t **it, *sf;
-	it = (stack_frame_t**)vector_back(&s->frames);
-	sf = *it;
 
-	assert(sf);
+	assert(s->frame);
+
+	slot = stack_frame_find(s->frame, name, 1);
+	if (slot->flags & STACK_SLOT_CONST)
+		LOG_WARNING_X("Redefining constant %s", symbol_c_str(name));
 
-	slot = stack_frame_find(sf, name, 1);
 	old_val = slot->value;
 	slot->value = clone_ref(val);
+	stack_frame_slot_changed(s->frame);
 	release_ref(&old_val);
-
-	if (s == current_stack)
-		frame_id = s->frames.size - 1;
-	else
-		frame_id = vector_findr(&current_stack->frames, sf, _stack_frame_eq);
-
-	if (frame_id != VECTOR_NPOS)
-		symbol_let(name, val, frame_id);
 }
 
 void stack_let(ref_t stack, ref_t name, ref_t val)
@@ -261,63 +300,56 @@ void stack_let(ref_t stack, ref_t name, ref_t val)
 	_stack_let(s, name, val);
 }
 
-static void _stack_enter(stack_t *s)
+int stack_set_const(ref_t stack, ref_t name, int is_const)
 {
-	size_t num_common, frame_id;
-	stack_frame_t **cur, **to, **it, **end;
-	stack_t *old_stack = current_stack;
-
-	if (s == current_stack)
-		return;
-
-	num_common = 0;
+	stack_slot_t *slot;
 
-	if (current_stack && s)
+	if (stack.type != stack_type || name.type != symbol_type)
 	{
-		/* step one: iterate through the two stacks from
-		   front to back to find out how many stack frames are shared */
-		cur = (stack_frame_t**)current_stack->frames.items;
-		to = (stack_frame_t**)s->frames.items;
-		while (*to == *cur)
-		{
-			++num_common;
-			++to;
-			++cur;
-		}
+		LOG_ERROR("Called with a non-stack or with name not a symbol.");
+		return 0;
 	}
 
-	if (current_stack)
+	slot = stack_find((stack_t*)stack.data.object, name, 0);
+	if (!slot)
 	{
-		/* step two: iterate backwards through the current stack to
-		   wipe out symbol bindings that are no longer applicable */
-		it = (stack_frame_t**)vector_end(&current_stack->frames);
-		end = (stack_frame_t**)vector_nth(&current_stack->frames, num_common);
-		frame_id = current_stack->frames.size;
-		while (it != end)
-		{
-			--it;
-			--frame_id;
-			stack_frame_pop_bindings(*it, frame_id);
-		}
+		LOG_ERROR_X("Can't make %s constant; it isn't bound", symbol_c_str(name));
+		return 0;
 	}
 
-	if (s)
+	if (is_const)
+		slot->flags |= STACK_SLOT_CONST;
+	else
+		slot->flags &= ~STACK_SLOT_CONST;
+	return 1;
+}
+
+int stack_is_const(ref_t stack, ref_t name)
+{
+	stack_slot_t *slot;
+
+	if (stack.type != stack_type || name.type != symbol_type)
 	{
-		/* step three: iterate forwards through the new stack to
-		   add symbol bindings that are now visible */
-		it = (stack_frame_t**)vector_nth(&s->frames, num_common);
-		end = (stack_frame_t**)vector_end(&s->frames);
-		frame_id = num_common;
-		while (it != end)
-		{
-			stack_frame_push_bindings(*it, frame_id);
-			++it;
-			++frame_id;
-		}
+		LOG_ERROR("Called with a non-stack or with name not a symbol.");
+		return 0;
+	}
+
+	slot = stack_find((stack_t*)stack.data.object, name, 0);
+	return slot && (slot->flags & STACK_SLOT_CONST);
+}
 
-		/* step four, set the current frame pointer */
+static void _stack_enter(stack_t *s)
+{
+	stack_t *old_stack = current_stack;
+
+	if (s == current_stack)
+		return;
+
+	/* symbols are resolved against the stack they are evaluated in, so entering a
+	   stack no longer has to touch any bindings; the current stack is only tracked
+	   so that it can be marked as a garbage collection root */
+	if (s)
 		gc_add_ref(&s->gc);
-	}
 
 	++stack_switch_count;
 	current_stack = s;
@@ -341,24 +373,31 @@ void stack_enter(ref_t stack)
 
 void stack_debug_print(stack_t *s, FILE *to)
 {
-	stack_frame_t **it, **front;
+	stack_t *it;
 
 	assert(s);
 
 	fprintf(to, "### Stack dump for stack %p:\n", s);
 	
-	front = (stack_frame_t**)s->frames.items;
-	it = (stack_frame_t**)vector_end(&s->frames);
-	while (it != front)
+	for (it = s; it; it = it->parent)
 	{
-		--it;
-
-		stack_frame_debug_print(*it, to);
+		stack_frame_debug_print(it->frame, to);
 		fprintf(to, "\n");
 	}
 	fprintf(to, "#################\n");
 }
 
+void stack_global_cleanup()
+{
+	while (stack_pool)
+	{
+		stack_t *s = stack_pool;
+		stack_pool = (stack_t*)s->gc.next_gc_object;
+		X_FREE(s);
+	}
+	stack_pool_size = 0;
+}
+
 void stack_gc_mark_root()
 {
 	if (current_stack)
@@ -4,7 +4,7 @@
 
 #include "gc.h"
 #include "ref.h"
-#include "vector.h"
+#include "stack_frame.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -14,10 +14,25 @@ typedef struct stack_ts stack_t;
 struct stack_ts
 {
 	gc_object_t gc;
-	vector_t frames; /* a vector of stack frames */
+	stack_frame_t *frame; /* the innermost frame; the rest are shared with the parent */
 	stack_t *parent;
+	size_t depth; /* index of this stack's frame, counting from the root (which is 0) */
+	unsigned long epoch; /* unique to this stack; symbols use it to validate their cached bindings */
 };
 
+/* finds the innermost slot binding name in s or one of its parents;
+   if frame is not null, it is set to the frame the slot belongs to */
+stack_slot_t *stack_find(stack_t *s, ref_t name, stack_frame_t **frame);
+
+/* makes a stack for a call whose frame can't be captured; it isn't registered with
+   the garbage collector, so it must be released with release_local_stack, which
+   frees it directly unless something has kept a reference to it */
+ref_t make_local_stack(ref_t parent, size_t size);
+void release_local_stack(ref_t *stack);
+
+/* frees the pool of unused stacks */
+void stack_global_cleanup();
+
 void stack_debug_print(stack_t *s, FILE *to);
 void stack_gc_mark_root();
 
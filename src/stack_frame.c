@@ -11,41 +11,201 @@
 #pragma warning(disable: 4996) /* 'foo' was declared deprecated [yeah, right, by whom, exactly?] */
 #endif
 
-stack_frame_t *make_stack_frame()
+static stack_frame_t *global_frame = 0;
+
+size_t global_binding_epoch = 0;
+
+/* freed frames, by the capacity of their slot vector; they are linked through gc.next_gc_object */
+static stack_frame_t *frame_pool[STACK_FRAME_POOL_MAX + 1] = {0};
+static size_t frame_pool_size[STACK_FRAME_POOL_MAX + 1] = {0};
+
+static stack_frame_t *_make_stack_frame(size_t size, int local)
 {
-	stack_frame_t *sf = (stack_frame_t*)X_MALLOC(sizeof(stack_frame_t));
-	gc_init_object(&sf->gc, stack_frame_type);
-	if (! sf)
+	stack_frame_t *sf;
+
+	if (size <= STACK_FRAME_POOL_MAX && frame_pool[size])
 	{
-		LOG_ERROR("Memory allocation error");
-		return 0;
+		sf = frame_pool[size];
+		frame_pool[size] = (stack_frame_t*)sf->gc.next_gc_object;
+		--frame_pool_size[size];
 	}
-	VECTOR_INIT_TYPE(&sf->items, stack_slot_t);
+	else
+	{
+		sf = (stack_frame_t*)X_MALLOC(sizeof(stack_frame_t));
+		if (! sf)
+		{
+			LOG_ERROR("Memory allocation error");
+			return 0;
+		}
+		VECTOR_INIT_TYPE(&sf->items, stack_slot_t);
+		vector_reserve(&sf->items, size);
+	}
+
+	if (local)
+		gc_init_local_object(&sf->gc, stack_frame_type);
+	else
+		gc_init_object(&sf->gc, stack_frame_type);
+	sf->index = 0;
+	sf->index_mask = 0;
 	return sf;
 }
 
+stack_frame_t *make_stack_frame(size_t size)
+{
+	return _make_stack_frame(size, 0);
+}
+
+stack_frame_t *make_local_stack_frame(size_t size)
+{
+	return _make_stack_frame(size, 1);
+}
+
+void stack_frame_global_cleanup()
+{
+	size_t n;
+
+	for (n = 0; n <= STACK_FRAME_POOL_MAX; ++n)
+	{
+		while (frame_pool[n])
+		{
+			stack_frame_t *sf = frame_pool[n];
+			frame_pool[n] = (stack_frame_t*)sf->gc.next_gc_object;
+			vector_clear(&sf->items);
+			X_FREE(sf);
+		}
+		frame_pool_size[n] = 0;
+	}
+}
+
+void stack_frame_make_global(stack_frame_t *sf)
+{
+	assert(sf && sf->items.size == 0);
+
+	if (!global_frame)
+		global_frame = sf;
+}
+
+/* keeps the symbol's global value cell and local bindings up to date
+   as slots are added to and removed from frames */
+static void _slot_added(stack_frame_t *sf, stack_slot_t *slot)
+{
+	symbol_t *symb = slot->symbol.data.symb;
+
+	if (sf == global_frame)
+	{
+		++global_binding_epoch;
+		symb->global_frame = sf;
+		symb->global_slot = vector_idx_from_it(&sf->items, slot);
+	}
+	else
+		slot->binding = symbol_push_binding(symb, sf, vector_idx_from_it(&sf->items, slot));
+}
+
+static void _slot_removed(stack_frame_t *sf, stack_slot_t *slot)
+{
+	symbol_t *symb = slot->symbol.data.symb;
+
+	if (sf == global_frame)
+	{
+		++global_binding_epoch;
+		symb->global_frame = 0;
+	}
+	else
+		symbol_remove_binding(symb, slot->binding);
+}
+
+void stack_frame_slot_changed(stack_frame_t *sf)
+{
+	if (sf == global_frame)
+		++global_binding_epoch;
+}
+
+static size_t _index_hash(symbol_t *symb)
+{
+	return hash_mix((uint64_t)(uintptr_t)symb);
+}
+
+static void _index_add(stack_frame_t *sf, size_t n)
+{
+	stack_slot_t *slot = (stack_slot_t*)vector_nth(&sf->items, n);
+	size_t h = _index_hash(slot->symbol.data.symb) & sf->index_mask;
+
+	while (sf->index[h])
+		h = (h + 1) & sf->index_mask;
+
+	sf->index[h] = n + 1;
+}
+
+/* (re)builds the index so that it has room for at least twice the current number of slots */
+static void _index_rebuild(stack_frame_t *sf)
+{
+	size_t cap = 32, n;
+
+	while (cap < sf->items.size * 2)
+		cap <<= 1;
+
+	X_FREE(sf->index);
+	sf->index = (size_t*)X_MALLOC(sizeof(size_t) * cap);
+	memset(sf->index, 0, sizeof(size_t) * cap);
+	sf->index_mask = cap - 1;
+
+	for (n = 0; n != sf->items.size; ++n)
+		_index_add(sf, n);
+}
+
+static stack_slot_t *_index_find(stack_frame_t *sf, ref_t name)
+{
+	size_t h = _index_hash(name.data.symb) & sf->index_mask;
+
+	while (sf->index[h])
+	{
+		stack_slot_t *slot = (stack_slot_t*)vector_nth(&sf->items, sf->index[h] - 1);
+		if (slot->symbol.data.symb == name.data.symb)
+			return slot;
+
+		h = (h + 1) & sf->index_mask;
+	}
+
+	return 0;
+}
+
 stack_slot_t *stack_frame_find(stack_frame_t *sf, ref_t name, int insert)
 {
 	stack_slot_t *it, *end;
 	
 	assert(sf);
+	assert(name.type == symbol_type);
 
-	it = (stack_slot_t*)sf->items.items;
-	end = (stack_slot_t*)vector_end(&sf->items);
-	while (it != end)
+	if (sf->index)
+		it = _index_find(sf, name);
+	else
 	{
-		if (eq(it->symbol, name))
-			return it;
-
-		++it;
+		/* slots are only ever keyed by symbols, so comparing the symbol pointers is enough */
+		it = (stack_slot_t*)sf->items.items;
+		end = (stack_slot_t*)vector_end(&sf->items);
+		while (it != end && it->symbol.data.symb != name.data.symb)
+			++it;
+
+		if (it == end)
+			it = 0;
 	}
 
-	if (!insert)
-		return 0;
+	if (it || !insert)
+		return it;
 
 	it = (stack_slot_t*)vector_insert(&sf->items, VECTOR_NPOS);
 	it->symbol = clone_ref(name);
 	it->value = nil();
+	it->flags = 0;
+	_slot_added(sf, it);
+
+	if (sf->index && sf->items.size * 2 <= sf->index_mask + 1)
+		_index_add(sf, sf->items.size - 1);
+	else if (sf->items.size >= STACK_FRAME_INDEX_MIN)
+		_index_rebuild(sf);
+
+	/* the new slot may shadow whatever the symbol was last resolved to */
+	symbol_reset_cache(name);
 	return it;
 }
 
@@ -63,7 +223,26 @@ void stack_frame_erase(stack_frame_t *sf, ref_t name)
 	{
 		if (eq(it->symbol, name))
 		{
+			_slot_removed(sf, it);
+			release_ref(&it->symbol);
+			release_ref(&it->value);
 			vector_erase(&sf->items, n);
+			symbol_reset_cache(name);
+
+			/* the slots after this one have moved down */
+			end = (stack_slot_t*)vector_end(&sf->items);
+			for (; it != end; ++it)
+			{
+				symbol_t *symb = it->symbol.data.symb;
+				if (sf == global_frame)
+					--symb->global_slot;
+				else
+					--((local_binding_t*)vector_nth(&symb->bindings, it->binding))->slot;
+			}
+
+			/* slot positions have moved */
+			if (sf->index)
+				_index_rebuild(sf);
 			return;
 		}
 
@@ -101,6 +280,8 @@ static void stack_frame_traits_gc_release_refs(ref_t instance)
 	end = (stack_slot_t*)vector_end(&sf->items);
 	while (it != end)
 	{
+		if (it->symbol.type == symbol_type)
+			_slot_removed(sf, it);
 		release_ref(&it->symbol);
 		release_ref(&it->value);
 
@@ -111,9 +292,26 @@ static void stack_frame_traits_gc_release_refs(ref_t instance)
 static void stack_frame_traits_gc_free_mem(ref_t instance)
 {
 	stack_frame_t *sf = (stack_frame_t*)instance.data.object;
+	size_t cap;
 
 	assert(sf);
 
+	if (sf == global_frame)
+		global_frame = 0;
+
+	X_FREE(sf->index);
+
+	/* the slots have already been released, so the frame can go straight back in the pool */
+	cap = sf->items.capacity;
+	if (cap <= STACK_FRAME_POOL_MAX && frame_pool_size[cap] < STACK_FRAME_POOL_DEPTH)
+	{
+		sf->items.size = 0;
+		sf->gc.next_gc_object = (gc_object_t*)frame_pool[cap];
+		frame_pool[cap] = sf;
+		++frame_pool_size[cap];
+		return;
+	}
+
 	vector_clear(&sf->items);
 	X_FREE(sf);
 }
@@ -126,6 +324,7 @@ static const type_traits_t stack_frame_traits =
 	0, /* no type name (hidden type) */
 	0, /* no eq (hidden type) */
 	0, /* no eql (hidden type) */
+	0, /* no hash (hidden type) */
 	gc_traits_addref,
 	gc_traits_release,
 	stack_frame_traits_gc_mark,
@@ -154,31 +353,3 @@ void stack_frame_debug_print(stack_frame_t *sf, FILE *to)
 		++it;
 	}
 }
-
-void stack_frame_pop_bindings(stack_frame_t *sf, size_t use_id)
-{
-	stack_slot_t *it, *end;
-	assert(sf);
-
-	it = (stack_slot_t*)vector_end(&sf->items);
-	end = (stack_slot_t*)sf->items.items;
-	while (it != end)
-	{
-		--it;
-		symbol_unset(it->symbol, use_id);
-	}
-}
-
-void stack_frame_push_bindings(stack_frame_t *sf, size_t use_id)
-{
-	stack_slot_t *it, *end;
-	assert(sf);
-
-	it = (stack_slot_t*)sf->items.items;
-	end = (stack_slot_t*)vector_end(&sf->items);
-	while (it != end)
-	{
-		symbol_let(it->symbol, it->value, use_id);
-		++it;
-	}
-}
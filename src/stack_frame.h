@@ -18,25 +18,56 @@ struct stack_frame_ts
 {
 	gc_object_t gc;
 	vector_t items; /* a vector of stack slots */
+	size_t *index; /* for large frames: open addressed table of slot positions + 1, keyed on symbol */
+	size_t index_mask; /* index capacity - 1 (capacity is a power of two) */
 };
 
+/* frames with at least this many slots get a hashed index */
+#define STACK_FRAME_INDEX_MIN (16)
+
+/* largest frame (in slots) that is kept for reuse, and how many are kept per size */
+#define STACK_FRAME_POOL_MAX (8)
+#define STACK_FRAME_POOL_DEPTH (256)
+
 typedef struct stack_slot_ts stack_slot_t;
 struct stack_slot_ts
 {
 	ref_t symbol;
 	ref_t value;
+	int flags; /* STACK_SLOT_* bits */
+	size_t binding; /* position in the symbol's local bindings (not used in the global frame) */
 };
 
-stack_frame_t *make_stack_frame();
+/* the binding can't be changed with set, and may be inlined into closures made while it is set */
+#define STACK_SLOT_CONST (1)
+
+/* returns a frame with room for size slots; frames of up to STACK_FRAME_POOL_MAX
+   slots are recycled, so if the size is known up front then making the frame and
+   filling it usually doesn't allocate anything */
+stack_frame_t *make_stack_frame(size_t size);
+
+/* as make_stack_frame, but the frame isn't registered with the garbage collector (see gc_init_local_object) */
+stack_frame_t *make_local_stack_frame(size_t size);
+
+/* makes sf (which must be empty) the global frame, if there isn't one already.
+   symbols with a slot in the global frame keep a direct pointer to it, which
+   they use whenever no other frame binds them; so every stack must have the
+   global frame at its root */
+void stack_frame_make_global(stack_frame_t *sf);
+
+/* called whenever the value in one of sf's slots is replaced */
+void stack_frame_slot_changed(stack_frame_t *sf);
+
+/* changes whenever a slot is added to or removed from the global frame, or one of its
+   values is replaced, so anything that remembers a global's value can tell that it's
+   still current by remembering the epoch along with it */
+extern size_t global_binding_epoch;
 
 void stack_frame_debug_print(stack_frame_t *sf, FILE *to);
 
 stack_slot_t *stack_frame_find(stack_frame_t *sf, ref_t name, int insert);
 void stack_frame_erase(stack_frame_t *sf, ref_t name);
 
-void stack_frame_pop_bindings(stack_frame_t *sf, size_t use_id);
-void stack_frame_push_bindings(stack_frame_t *sf, size_t use_id);
-
 #ifdef __cplusplus
 } /* end extern "C" */
 #endif
@@ -472,6 +472,13 @@ int str_to_int(const str_t *str)
     return atoi(str->c_str);
 }
 
+/* Convert to 64 bit integer (saturates if it's out of range) */
+int64_t str_to_int64(const str_t *str)
+{
+    errno = 0;
+    return (int64_t)strtoll(str->c_str, 0, 10);
+}
+
 /* Convert to double */
 double str_to_double(const str_t *str)
 {
@@ -138,6 +138,8 @@ void str_append_char(str_t *str, char c);
 int str_indexof(const str_t *str, const char ch);
 /* Convert to integer */
 int str_to_int(const str_t *str);
+/* Convert to 64 bit integer (saturates if it's out of range, and sets errno to ERANGE) */
+int64_t str_to_int64(const str_t *str);
 /* Convert to double */
 double str_to_double(const str_t *str);
 
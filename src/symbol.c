@@ -11,13 +11,6 @@ static rbtn_t *symbol_trees[NUM_SYMBOL_TREES] = {0}; /* set of red-black tree ro
 
 int symbol_eval_count = 0;
 
-typedef struct binding_ts binding_t;
-struct binding_ts
-{
-	ref_t val;
-	size_t stack_pos;
-};
-
 static int _symbol_rbt_cmp(void *s1, void *s2)
 {
 	int a, b;
@@ -133,14 +126,13 @@ static void symbol_traits_release(ref_t instance)
 		ref_t ref;
 		rbtn_t **root = &symbol_trees[symb->name->hash % NUM_SYMBOL_TREES];
 		rbtn_del(root, 0, symb->name, _symbol_rbt_cmp, 0, 0);
+		assert(symb->bindings.size == 0);
+		vector_clear(&symb->bindings);
 
 		assert(string_type && string_type->release);
 		ref.type = string_type;
 		ref.data.str = symb->name;
 
-		/* do not need to release the references in the binding stack,
-		   because they are weak refs */
-		vector_clear(&symb->binding_stack);
 		XX_FREE(symb, string_c_str(symb->name));
 
 		string_type->release(ref);
@@ -167,24 +159,54 @@ static int symbol_traits_eq(ref_t a, ref_t b)
 	return a.data.symb == b.data.symb;
 }
 
+static stack_slot_t *_symbol_resolve(symbol_t *symb, ref_t name, stack_t *s)
+{
+	stack_slot_t *slot;
+	stack_frame_t *sf;
+
+	/* names bound in the frame they're used in are the usual case */
+	if (symb->bindings.size)
+	{
+		local_binding_t *top = (local_binding_t*)vector_back(&symb->bindings);
+		if (top->frame == s->frame)
+			return (stack_slot_t*)top->frame->items.items + top->slot;
+	}
+
+	if (symb->cache_epoch == s->epoch)
+		return (stack_slot_t*)vector_nth(&symb->cache_frame->items, symb->cache_slot);
+
+	slot = stack_find(s, name, &sf);
+	if (slot)
+	{
+		symb->cache_epoch = s->epoch;
+		symb->cache_frame = sf;
+		symb->cache_slot = vector_idx_from_it(&sf->items, slot);
+	}
+
+	return slot;
+}
+
 static ref_t symbol_traits_eval(ref_t instance, ref_t context)
 {
 	symbol_t *symb;
+	stack_slot_t *slot;
 	ref_t result;
 
 	symb = instance.data.symb;
 	trace(TRACE_FULL, "evaluating symbol \"%r\"", instance);
 
-	if (symb->binding_stack.size == 0)
+	/* most references are to globals that nothing shadows */
+	slot = SYMBOL_GLOBAL_SLOT(symb);
+	if (!slot && context.type == stack_type)
+		slot = _symbol_resolve(symb, instance, (stack_t*)context.data.object);
+
+	if (!slot)
 	{
 		LOG_ERROR_X("Unbound symbol: %s", string_c_str(symb->name));
 		result = nil();
 	}
 	else
-	{
-		binding_t *it = (binding_t*)vector_back(&symb->binding_stack);
-		result = clone_ref(it->val);
-	}
+		result = clone_ref(slot->value);
 
 	++symbol_eval_count;
 
@@ -200,6 +222,7 @@ static const type_traits_t symbol_traits =
 	symbol_traits_type_name,
 	symbol_traits_eq,
 	symbol_traits_eq, /* eq and eql do the same thing for symbols */
+	hash_eq,
 	symbol_traits_addref,
 	symbol_traits_release,
 	0, /* not garbage collected */
@@ -230,7 +253,12 @@ ref_t make_symbol(const char *name, size_t len)
 		add_ref(name_ref);
 		symb->name = str;
 		symb->rc = 1;
-		VECTOR_INIT_TYPE(&symb->binding_stack, binding_t);
+		symb->cache_epoch = 0;
+		symb->cache_frame = 0;
+		symb->cache_slot = 0;
+		symb->global_frame = 0;
+		symb->global_slot = 0;
+		VECTOR_INIT_TYPE(&symb->bindings, local_binding_t);
 
 		node->data = symb;
 	}
@@ -273,98 +301,43 @@ const char *symbol_c_str(ref_t ref)
 	return safe_buf;
 }
 
-static binding_t *find_binding(symbol_t *symb, size_t start_frame)
+size_t symbol_push_binding(symbol_t *symb, stack_frame_t *sf, size_t slot)
 {
-	binding_t *it, *front;
-
-	front = (binding_t*)symb->binding_stack.items;
-	it = (binding_t*)vector_end(&symb->binding_stack);
-	while (it != front)
-	{
-		--it;
+	local_binding_t *b;
 
-		if (it->stack_pos <= start_frame)
-			return it;
-	}
+	b = (local_binding_t*)vector_insert(&symb->bindings, VECTOR_NPOS);
+	b->frame = sf;
+	b->slot = slot;
 
-	return 0;
+	return symb->bindings.size - 1;
 }
 
-void symbol_let(ref_t symbol, ref_t value, size_t frame)
+void symbol_remove_binding(symbol_t *symb, size_t binding)
 {
-	symbol_t *symb = symbol.data.symb;
-	binding_t *cur_val;
-
-	if (symbol.type != symbol_type)
-	{
-		LOG_ERROR("Called with a non-symbol.");
-		return;
-	}
+	local_binding_t *b;
 
-	cur_val = find_binding(symb, frame);
-	if (!cur_val)
-	{
-		cur_val = vector_insert(&symb->binding_stack, VECTOR_NPOS);
-		cur_val->stack_pos = frame;
-		cur_val->val = value;
-		return;
-	}
-	else
-	{
-		if (cur_val->stack_pos == frame)
-			cur_val->val = value;
-		else if (cur_val->stack_pos < frame)
-		{
-			size_t n = vector_idx_from_it(&symb->binding_stack, cur_val);
-			cur_val = (binding_t*)vector_insert(&symb->binding_stack, n + 1);
+	assert(binding < symb->bindings.size);
 
-			cur_val->stack_pos = frame;
-			cur_val->val = value;
-		}
-		else
-		{
-			LOG_ERROR("WTFLOL THIS CAN'T HAPPEN!");
-		}
-	}
-}
+	b = (local_binding_t*)vector_nth(&symb->bindings, binding);
+	b->frame = 0;
 
-void symbol_set(ref_t symbol, ref_t new_value, size_t start_frame)
-{
-	symbol_t *symb = symbol.data.symb;
-	binding_t *cur_val;
-
-	if (symbol.type != symbol_type)
-	{
-		LOG_ERROR("Called with a non-symbol.");
+	if (binding != symb->bindings.size - 1)
 		return;
-	}
 
-	cur_val = find_binding(symb, start_frame);
-	if (!cur_val)
+	do
 	{
-		LOG_ERROR("Attempting to rebind and unbound symbol.");
-		return;
-	}
-	else
-		cur_val->val = new_value;
+		vector_erase_back(&symb->bindings);
+		b = (local_binding_t*)vector_back(&symb->bindings);
+	} while (b && !b->frame);
 }
 
-void symbol_unset(ref_t symbol, size_t frame)
+void symbol_reset_cache(ref_t symbol)
 {
-	symbol_t *symb = symbol.data.symb;
-	binding_t *cur_val;
-	size_t n;
-
 	if (symbol.type != symbol_type)
 	{
 		LOG_ERROR("Called with a non-symbol.");
 		return;
 	}
 
-	cur_val = find_binding(symb, frame);
-	if (!cur_val || cur_val->stack_pos != frame)
-		return;
-
-	n = vector_idx_from_it(&symb->binding_stack, cur_val);
-	vector_erase(&symb->binding_stack, n);
+	symbol.data.symb->cache_epoch = 0;
 }
@@ -10,20 +10,46 @@ extern "C" {
 #include "sl_string.h"
 #include "stack.h"
 
-/* nb: symbols do contain references to other objects, but do not have to be handled by the,
-   mark/sweep garbage collector, because they only contain weak references,
-   so they can't create cycles.  The strong references are held in the stack frame objects;
-   the references that symbols hold in their value stack is just a way of caching the data */
+/* nb: symbols do not have to be handled by the mark/sweep garbage collector;
+   the only thing they point at besides their name is the slot that they were
+   last resolved to, and that is just a cache: it is only used while the stack
+   it was resolved in is still alive (stack epochs are never reused).  the
+   global value cell points into the global frame, which holds a ref to the
+   symbol and clears the cell before it lets go of it */
+/* a slot for a symbol in a frame other than the global one */
+typedef struct local_binding_ts
+{
+	stack_frame_t *frame; /* 0 if the slot has gone but couldn't be popped yet */
+	size_t slot; /* position of the slot in the frame */
+} local_binding_t;
+
 struct symbol_ts
 {
 	unsigned long rc;
 	string_t *name;
-	vector_t binding_stack;
+	unsigned long cache_epoch; /* epoch of the stack the cached slot was found from, or 0 */
+	stack_frame_t *cache_frame;
+	size_t cache_slot;
+	stack_frame_t *global_frame; /* the global frame, if the symbol has a slot in it, otherwise 0 */
+	size_t global_slot; /* position of that slot */
+	vector_t bindings; /* local_binding_t for each slot for the symbol in any other frame, most
+	                      recently made last.  the last entry is always a live one, so this is
+	                      only empty if the symbol has no local slots */
 };
 
-void symbol_let(ref_t symbol, ref_t value, size_t frame);
-void symbol_set(ref_t symbol, ref_t new_value, size_t start_frame);
-void symbol_unset(ref_t symbol, size_t frame);
+/* forgets the cached binding; called whenever a slot for the symbol is added or removed */
+void symbol_reset_cache(ref_t symbol);
+
+/* records a new local slot for the symbol, and returns its position in the symbol's bindings.
+   slots are usually removed in the reverse order that they were made, so removing one is
+   normally a pop; otherwise the entry is just cleared (slots remember their position, so
+   this doesn't need a search) and is popped once everything above it has gone */
+size_t symbol_push_binding(symbol_t *symb, stack_frame_t *sf, size_t slot);
+void symbol_remove_binding(symbol_t *symb, size_t binding);
+
+/* returns the symbol's slot in the global frame if nothing else binds it, otherwise 0 */
+#define SYMBOL_GLOBAL_SLOT(symb) (((symb)->bindings.size || !(symb)->global_frame) ? 0 : \
+	(stack_slot_t*)(symb)->global_frame->items.items + (symb)->global_slot)
 
 extern int symbol_eval_count;
 
@@ -0,0 +1,21 @@
+-- writes a script with lots of top-level definitions, for timing how long it takes to load a large environment
+--
+-- usage: lua tools/defs_bench.lua [count] > defs-bench.smalisp
+--        time ./smalisp -q defs-bench.smalisp
+
+local count = tonumber(arg[1]) or 10000
+
+-- every definition goes into the top-level frame, and each one calls the previous
+-- definition, so the loop below also looks up every name once more
+io.write('(let def-0 (fn (x) x))\n')
+for i = 1, count - 1 do
+  io.write('(let def-' .. i .. ' (fn (x) (def-' .. (i - 1) .. ' x)))\n')
+end
+
+-- rebind everything once with set, which has to find the existing slot
+for i = 0, count - 1, 97 do
+  io.write('(set def-' .. i .. ' (fn (x) (+ x ' .. i .. ')))\n')
+end
+
+io.write('(print (def-' .. (count - 1) .. ' 1))\n')
+io.write('(exit)\n')